@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+#include "amp_commands.hpp"
+
+namespace
+{
+// Reads a channel or line number no larger than max
+bool read_index(std::istringstream& fields, size_t max, size_t& out)
+{
+  long long value = 0;
+  if (!(fields >> value) || value < 0 || static_cast<size_t>(value) > max) {
+    return false;
+  }
+  out = static_cast<size_t>(value);
+  return true;
+}
+
+bool read_offset(std::istringstream& fields, double& out)
+{
+  double value = 0;
+  if (!(fields >> value) || !std::isfinite(value)) {
+    return false;
+  }
+  out = value;
+  return true;
+}
+
+// Offsets are kept in the units of the mode
+void change_mode(am_amp2400::amp_config& config, am_amp2400::amp_mode mode)
+{
+  using am_amp2400::amp_profile;
+  const am_amp2400::mode_settings& old_settings =
+      am_amp2400::settings_for<amp_profile>(config.mode);
+  const am_amp2400::mode_settings& new_settings =
+      am_amp2400::settings_for<amp_profile>(mode);
+  config.mode = mode;
+  config.ai_offset *= old_settings.offset_ai_gain / new_settings.offset_ai_gain;
+  config.ao_offset *= old_settings.offset_ao_gain / new_settings.offset_ao_gain;
+}
+}  // namespace
+
+std::string am_amp2400::run_commands(std::string_view text,
+                                     const command_limits& limits,
+                                     command_batch& batch)
+{
+  std::istringstream commands {std::string(text)};
+  std::string command;
+  while (std::getline(commands, command, ';')) {
+    std::istringstream fields(command);
+    std::string verb;
+    if (!(fields >> verb)) {
+      continue;
+    }
+    amp_config& config = batch.amps[batch.amp];
+    bool valid = true;
+    if (verb == "amp") {
+      size_t number = 0;
+      valid = read_index(fields, limits.amp_count, number) && number > 0;
+      batch.amp = valid ? number - 1 : batch.amp;
+    } else if (verb == "mode") {
+      std::string name;
+      fields >> name;
+      const auto* found = std::find(
+          COMMAND_MODE_NAMES.begin(), COMMAND_MODE_NAMES.end(), name);
+      valid = found != COMMAND_MODE_NAMES.end();
+      if (valid) {
+        change_mode(config, amp_mode(found - COMMAND_MODE_NAMES.begin()));
+      }
+    } else if (verb == "probe") {
+      std::string gain;
+      fields >> gain;
+      valid = gain == "low" || gain == "high";
+      config.probe_gain = gain == "high" ? HIGH : LOW;
+    } else if (verb == "ai_offset") {
+      valid = read_offset(fields, config.ai_offset);
+    } else if (verb == "ao_offset") {
+      valid = read_offset(fields, config.ao_offset);
+    } else if (verb == "input") {
+      valid = read_index(
+          fields, limits.max_channel, config.channels.input_channel);
+    } else if (verb == "output") {
+      valid = read_index(
+          fields, limits.max_channel, config.channels.output_channel);
+    } else if (verb == "telegraph") {
+      for (size_t& line : config.channels.telegraph_lines) {
+        valid = valid && read_index(fields, limits.max_line, line);
+      }
+    } else if (verb == "apply") {
+      batch.apply = true;
+    } else if (verb != "state") {
+      return verb + ": unknown command";
+    }
+    if (!valid || !(fields >> std::ws).eof()) {
+      return verb + ": invalid argument";
+    }
+    batch.touched |= 1U << batch.amp;
+    batch.edited = batch.edited
+        || (verb != "amp" && verb != "apply" && verb != "state");
+  }
+  return {};
+}
+
+std::string am_amp2400::describe_amp(size_t amp,
+                                     const amp_config& config,
+                                     bool applied)
+{
+  std::ostringstream text;
+  text << "amp=" << amp + 1 << " mode="
+       << (valid_mode(config.mode)
+               ? COMMAND_MODE_NAMES[static_cast<size_t>(config.mode)]
+               : std::string_view("unknown"))
+       << " probe=" << (config.probe_gain == HIGH ? "high" : "low")
+       << " input=" << config.channels.input_channel
+       << " output=" << config.channels.output_channel << " telegraph="
+       << config.channels.telegraph_lines[0] << ','
+       << config.channels.telegraph_lines[1] << ','
+       << config.channels.telegraph_lines[2]
+       // Enough digits to read back as the same offset, as on the panel
+       << std::setprecision(std::numeric_limits<double>::max_digits10)
+       << " ai_offset=" << config.ai_offset
+       << " ao_offset=" << config.ao_offset << " applied=" << applied;
+  return text.str();
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "daq_state.hpp"
+
+namespace am_amp2400
+{
+
+// Mode names used in text commands, indexed by amp_mode
+constexpr std::array<std::string_view, NUM_AMP_MODES> COMMAND_MODE_NAMES = {
+    "vclamp", "i0", "iclamp", "vcomp", "vtest", "iresist", "ifollow"};
+
+// Largest values the commands accept, as allowed by the panel
+struct command_limits
+{
+  size_t amp_count;
+  size_t max_channel;
+  size_t max_line;
+};
+
+// Amplifier configurations being edited by a list of commands
+struct command_batch
+{
+  std::array<amp_config, MAX_AMPLIFIERS> amps;
+  // Amplifier the commands apply to
+  size_t amp;
+  // Bit i is set once a command addressed amplifier i
+  uint32_t touched;
+  // Whether "apply" was requested and whether any setting was changed
+  bool apply;
+  bool edited;
+};
+
+// Runs commands separated by ';' on the batch:
+//
+//   amp N | mode NAME | probe low|high | ai_offset V | ao_offset V |
+//   input N | output N | telegraph N N N | apply | state
+//
+// Amplifiers are numbered from 1. Offsets are in the units of the mode, and
+// changing the mode rescales them as the panel does. Returns an empty
+// string on success, otherwise "COMMAND: reason" for the first bad command;
+// the batch is then partly edited and should be dropped.
+std::string run_commands(std::string_view text,
+                         const command_limits& limits,
+                         command_batch& batch);
+
+// "amp=N mode=NAME probe=... applied=0|1", as reported to clients
+std::string describe_amp(size_t amp, const amp_config& config, bool applied);
+
+}  // namespace am_amp2400
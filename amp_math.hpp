@@ -0,0 +1,300 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace am_amp2400
+{
+
+// Sum of a contiguous block. Four independent accumulators break the
+// dependency chain so the compiler can keep the loop in vector registers
+// without needing -ffast-math.
+inline double block_sum(const double* values, size_t count)
+{
+  double acc0 = 0.0;
+  double acc1 = 0.0;
+  double acc2 = 0.0;
+  double acc3 = 0.0;
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    acc0 += values[i];
+    acc1 += values[i + 1];
+    acc2 += values[i + 2];
+    acc3 += values[i + 3];
+  }
+  for (; i < count; ++i) {
+    acc0 += values[i];
+  }
+  return (acc0 + acc1) + (acc2 + acc3);
+}
+
+// Sum of squared deviations from center, same layout as block_sum
+inline double block_sum_squared_deviation(const double* values,
+                                          size_t count,
+                                          double center)
+{
+  double acc0 = 0.0;
+  double acc1 = 0.0;
+  double acc2 = 0.0;
+  double acc3 = 0.0;
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const double d0 = values[i] - center;
+    const double d1 = values[i + 1] - center;
+    const double d2 = values[i + 2] - center;
+    const double d3 = values[i + 3] - center;
+    acc0 += d0 * d0;
+    acc1 += d1 * d1;
+    acc2 += d2 * d2;
+    acc3 += d3 * d3;
+  }
+  for (; i < count; ++i) {
+    const double d = values[i] - center;
+    acc0 += d * d;
+  }
+  return (acc0 + acc1) + (acc2 + acc3);
+}
+
+// Sum of index * value over a block, same layout as block_sum
+inline double block_sum_indexed(const double* values, size_t count)
+{
+  double acc0 = 0.0;
+  double acc1 = 0.0;
+  double acc2 = 0.0;
+  double acc3 = 0.0;
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    acc0 += double(i) * values[i];
+    acc1 += double(i + 1) * values[i + 1];
+    acc2 += double(i + 2) * values[i + 2];
+    acc3 += double(i + 3) * values[i + 3];
+  }
+  for (; i < count; ++i) {
+    acc0 += double(i) * values[i];
+  }
+  return (acc0 + acc1) + (acc2 + acc3);
+}
+
+// Largest absolute value in a block. Written as a compare and select,
+// which maps onto maxpd, but GCC only vectorises that reduction at some
+// optimisation levels (std::fmax is a libm call as it has to handle NaN),
+// so SSE2 builds spell it out. NaN samples are skipped either way.
+inline double block_max_abs(const double* values, size_t count)
+{
+  double m = 0.0;
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128d sign = _mm_set1_pd(-0.0);
+  __m128d acc0 = _mm_setzero_pd();
+  __m128d acc1 = _mm_setzero_pd();
+  for (const size_t end = count - count % 4; i < end; i += 4) {
+    // Argument order matters: maxpd returns the second one for NaN
+    acc0 = _mm_max_pd(_mm_andnot_pd(sign, _mm_loadu_pd(values + i)), acc0);
+    acc1 =
+        _mm_max_pd(_mm_andnot_pd(sign, _mm_loadu_pd(values + i + 2)), acc1);
+  }
+  acc0 = _mm_max_pd(acc0, acc1);
+  m = _mm_cvtsd_f64(_mm_max_sd(acc0, _mm_unpackhi_pd(acc0, acc0)));
+#endif
+  for (; i < count; ++i) {
+    const double a = std::fabs(values[i]);
+    m = a > m ? a : m;
+  }
+  return m;
+}
+
+struct line_fit
+{
+  double slope;
+  // Value of the line at x = 0
+  double intercept;
+};
+
+// Least-squares line through values[i] placed at x = first_x + i. The sums
+// over x have closed forms, so only two passes over the values are needed.
+inline line_fit fit_line(const double* values, size_t count, double first_x)
+{
+  if (count < 2) {
+    return {0.0, count == 1 ? values[0] : 0.0};
+  }
+  const double n = double(count);
+  const double sum_i = n * (n - 1.0) / 2.0;
+  const double sum_ii = (n - 1.0) * n * (2.0 * n - 1.0) / 6.0;
+  const double sum_y = block_sum(values, count);
+  const double sum_iy = block_sum_indexed(values, count);
+  const double slope =
+      (n * sum_iy - sum_i * sum_y) / (n * sum_ii - sum_i * sum_i);
+  const double intercept_at_first = (sum_y - slope * sum_i) / n;
+  return {slope, intercept_at_first - slope * first_x};
+}
+
+// Sum of (x - x_center) * (y - y_center) over two blocks, same layout as
+// block_sum
+inline double block_sum_cross_deviation(const double* x,
+                                        const double* y,
+                                        size_t count,
+                                        double x_center,
+                                        double y_center)
+{
+  double acc0 = 0.0;
+  double acc1 = 0.0;
+  double acc2 = 0.0;
+  double acc3 = 0.0;
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    acc0 += (x[i] - x_center) * (y[i] - y_center);
+    acc1 += (x[i + 1] - x_center) * (y[i + 1] - y_center);
+    acc2 += (x[i + 2] - x_center) * (y[i + 2] - y_center);
+    acc3 += (x[i + 3] - x_center) * (y[i + 3] - y_center);
+  }
+  for (; i < count; ++i) {
+    acc0 += (x[i] - x_center) * (y[i] - y_center);
+  }
+  return (acc0 + acc1) + (acc2 + acc3);
+}
+
+// Least-squares line through the points (x[i], y[i]). The sums are taken
+// around the means, which keeps them accurate when the x values sit far
+// from zero.
+inline line_fit fit_line(const double* x, const double* y, size_t count)
+{
+  if (count < 2) {
+    return {0.0, count == 1 ? y[0] : 0.0};
+  }
+  const double x_mean = block_sum(x, count) / double(count);
+  const double y_mean = block_sum(y, count) / double(count);
+  const double sxx = block_sum_squared_deviation(x, count, x_mean);
+  if (sxx == 0.0) {
+    return {0.0, y_mean};
+  }
+  const double slope =
+      block_sum_cross_deviation(x, y, count, x_mean, y_mean) / sxx;
+  return {slope, y_mean - slope * x_mean};
+}
+
+// Estimates the mean of a stream and stops as soon as the standard error of
+// the mean drops below a tolerance. Samples are buffered and reduced a block
+// at a time, and the block statistics are merged into the running ones with
+// Chan's parallel update. Everything lives inline, so it can run on the
+// real-time thread.
+template<size_t BlockSize = 64>
+class mean_estimator
+{
+public:
+  void reset(uint64_t min_samples, uint64_t max_samples, double tolerance)
+  {
+    min_count = min_samples;
+    max_count = max_samples > min_samples ? max_samples : min_samples;
+    max_standard_error = tolerance;
+    fill = 0;
+    samples = 0;
+    running_mean = 0.0;
+    running_m2 = 0.0;
+    done = false;
+  }
+
+  // Returns true once the estimate has converged or hit the sample limit
+  bool push(double sample)
+  {
+    if (done) {
+      return true;
+    }
+    block[fill++] = sample;
+    if (fill == BlockSize || samples + fill >= max_count) {
+      flush();
+      done = samples >= max_count
+          || (samples >= min_count && standard_error() <= max_standard_error);
+    }
+    return done;
+  }
+
+  bool finished() const { return done; }
+  uint64_t count() const { return samples; }
+  double mean() const { return running_mean; }
+
+  double variance() const
+  {
+    return samples > 1 ? running_m2 / double(samples - 1) : 0.0;
+  }
+
+  double standard_error() const
+  {
+    return samples > 1 ? std::sqrt(variance() / double(samples))
+                       : INFINITY;
+  }
+
+private:
+  void flush()
+  {
+    if (fill == 0) {
+      return;
+    }
+    const double block_count = double(fill);
+    const double block_mean = block_sum(block.data(), fill) / block_count;
+    const double block_m2 =
+        block_sum_squared_deviation(block.data(), fill, block_mean);
+    const double total = double(samples) + block_count;
+    const double delta = block_mean - running_mean;
+    running_mean += delta * block_count / total;
+    running_m2 +=
+        block_m2 + delta * delta * double(samples) * block_count / total;
+    samples += fill;
+    fill = 0;
+  }
+
+  std::array<double, BlockSize> block {};
+  size_t fill = 0;
+  uint64_t samples = 0;
+  uint64_t min_count = 0;
+  uint64_t max_count = 0;
+  double max_standard_error = 0.0;
+  double running_mean = 0.0;
+  double running_m2 = 0.0;
+  bool done = false;
+};
+
+// Exponentially weighted baseline of a signal that should sit at zero.
+// Reports when the baseline has drifted past a threshold, after at least one
+// time constant worth of samples has been seen since the last reset.
+class drift_tracker
+{
+public:
+  // The smoothing factor is the period divided by the time constant
+  void configure(double smoothing_factor, double drift_threshold)
+  {
+    alpha = smoothing_factor;
+    threshold = drift_threshold;
+    warmup = alpha > 0.0 ? static_cast<uint64_t>(1.0 / alpha) : 0;
+    reset();
+  }
+
+  void reset()
+  {
+    level = 0.0;
+    samples = 0;
+  }
+
+  bool push(double sample)
+  {
+    level += alpha * (sample - level);
+    ++samples;
+    return samples >= warmup && std::fabs(level) > threshold;
+  }
+
+  double baseline() const { return level; }
+
+private:
+  double alpha = 0.0;
+  double threshold = 0.0;
+  double level = 0.0;
+  uint64_t warmup = 0;
+  uint64_t samples = 0;
+};
+
+}  // namespace am_amp2400
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace am_amp2400
+{
+
+enum amp_mode : int8_t
+{
+  VCLAMP = 0,
+  IEQ0,
+  ICLAMP,
+  VCOMP,
+  VTEST,
+  IRESIST,
+  IFOLLOW,
+  UNKNOWN
+};
+
+constexpr size_t NUM_AMP_MODES = static_cast<size_t>(amp_mode::UNKNOWN);
+
+enum probe_gain_t : std::uint8_t
+{
+  LOW = 0,
+  HIGH
+};
+
+// Voltages written to the telegraph lines
+constexpr double TELEGRAPH_LOW = 0.0;
+constexpr double TELEGRAPH_HIGH = 5.0;
+
+// Everything the DAQ needs to know about one amplifier mode. Gains marked as
+// probe scaled are multiplied by the probe gain factor when applied.
+struct mode_settings
+{
+  size_t ai_range;
+  double ai_gain;
+  double ao_gain;
+  bool ai_probe_scaled;
+  bool ao_probe_scaled;
+  std::array<double, 3> telegraph;
+  // Gains used to rescale the offsets shown in the panel when the mode
+  // changes, together with the units they are displayed in.
+  double offset_ai_gain;
+  double offset_ao_gain;
+  std::string_view ai_units;
+  std::string_view ao_units;
+};
+
+// Gains and offsets resolved for a given probe gain, ready to be applied.
+struct resolved_settings
+{
+  size_t ai_range;
+  double ai_gain;
+  double ao_gain;
+  std::array<double, 3> telegraph;
+};
+
+// Amplifier profiles describe a model through a constexpr table indexed by
+// amp_mode. Sibling amplifier models only need to provide a new profile.
+struct am2400_profile
+{
+  static constexpr double iclamp_ai_gain = 1.0;  // (1 V / V)
+  static constexpr double iclamp_ao_gain = 1.0;  // (2 nA / V) ...hmm
+  static constexpr double izero_ai_gain = 200e-3;  // (1 V / V)
+  static constexpr double izero_ao_gain = 1;  // No output
+  static constexpr double vclamp_ai_gain = 2e-9;  // 1 mV / pA
+  static constexpr double vclamp_ao_gain = 50;  // 50 mV / V
+  // Current injected per volt of command in the current clamp modes
+  static constexpr double iclamp_command_current = 2e-9;  // 2 nA / V
+
+  // Indexed by probe_gain_t
+  static constexpr std::array<double, 2> probe_gain_factors = {
+      10,  // LOW
+      1,  // HIGH
+  };
+
+  static constexpr std::array<mode_settings, NUM_AMP_MODES> modes = {{
+      // VCLAMP
+      {0,
+       vclamp_ai_gain,
+       vclamp_ao_gain,
+       false,
+       false,
+       {TELEGRAPH_LOW, TELEGRAPH_HIGH, TELEGRAPH_LOW},
+       vclamp_ai_gain,
+       vclamp_ao_gain,
+       "1 mV/pA",
+       "20 mV/V"},
+      // IEQ0
+      {3,
+       izero_ai_gain,
+       izero_ao_gain,
+       false,
+       true,
+       {TELEGRAPH_HIGH, TELEGRAPH_HIGH, TELEGRAPH_LOW},
+       izero_ai_gain,
+       izero_ao_gain,
+       "1 V/V",
+       "---"},
+      // ICLAMP
+      {3,
+       iclamp_ai_gain,
+       iclamp_ao_gain,
+       false,
+       false,
+       {TELEGRAPH_LOW, TELEGRAPH_LOW, TELEGRAPH_HIGH},
+       iclamp_ai_gain,
+       iclamp_ao_gain,
+       "1 V/V",
+       "2 nA/V"},
+      // VCOMP
+      {0,
+       vclamp_ai_gain,
+       vclamp_ao_gain,
+       false,
+       false,
+       {TELEGRAPH_HIGH, TELEGRAPH_LOW, TELEGRAPH_LOW},
+       vclamp_ai_gain,
+       vclamp_ao_gain,
+       "1 mV/pA",
+       "20 mV/V"},
+      // VTEST
+      {0,
+       vclamp_ai_gain,
+       vclamp_ao_gain,
+       false,
+       false,
+       {TELEGRAPH_LOW, TELEGRAPH_LOW, TELEGRAPH_LOW},
+       vclamp_ai_gain,
+       vclamp_ao_gain,
+       "1 mV/pA",
+       "20 mV/V"},
+      // IRESIST
+      {3,
+       iclamp_ai_gain,
+       iclamp_ao_gain,
+       false,
+       true,
+       {TELEGRAPH_HIGH, TELEGRAPH_LOW, TELEGRAPH_HIGH},
+       iclamp_ai_gain,
+       iclamp_ao_gain,
+       "1 V/V",
+       "2 nA/V"},
+      // IFOLLOW
+      {3,
+       iclamp_ai_gain,
+       iclamp_ao_gain,
+       true,
+       false,
+       {TELEGRAPH_LOW, TELEGRAPH_HIGH, TELEGRAPH_HIGH},
+       iclamp_ai_gain,
+       iclamp_ao_gain,
+       "1 V/V",
+       "2 nA/V"},
+  }};
+};
+
+// The profile used by the panel and the real-time component
+using amp_profile = am2400_profile;
+
+constexpr bool valid_mode(int mode)
+{
+  return mode >= 0 && mode < static_cast<int>(NUM_AMP_MODES);
+}
+
+template<class Profile>
+constexpr const mode_settings& settings_for(amp_mode mode)
+{
+  return Profile::modes[static_cast<size_t>(mode)];
+}
+
+template<class Profile>
+constexpr double probe_gain_factor_for(probe_gain_t probe_gain)
+{
+  return Profile::probe_gain_factors[static_cast<size_t>(probe_gain)];
+}
+
+// Looks the mode up in the profile table and folds in the probe gain. The
+// mode must be valid.
+template<class Profile>
+constexpr resolved_settings resolve_mode(amp_mode mode,
+                                         double probe_gain_factor)
+{
+  const mode_settings& settings = settings_for<Profile>(mode);
+  const double ai_factor = settings.ai_probe_scaled ? probe_gain_factor : 1.0;
+  const double ao_factor = settings.ao_probe_scaled ? probe_gain_factor : 1.0;
+  return {settings.ai_range,
+          settings.ai_gain * ai_factor,
+          settings.ao_gain * ao_factor,
+          settings.telegraph};
+}
+
+}  // namespace am_amp2400
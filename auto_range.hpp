@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "amp_math.hpp"
+
+namespace am_amp2400
+{
+
+// Most input ranges the auto-ranging chooses from
+constexpr size_t MAX_AUTO_RANGES = 16;
+// Samples whose peak decides whether a narrower range fits
+constexpr size_t AUTO_RANGE_BLOCK_SIZE = 64;
+
+// A sample above this fraction of the full scale moves to a wider range at
+// once, before the converter clips
+constexpr double AUTO_RANGE_UP_FRACTION = 0.9;
+// The signal must stay below this fraction of the next narrower full scale
+// before moving down. Being under the up fraction, it leaves room for the
+// signal to grow without bouncing straight back.
+constexpr double AUTO_RANGE_DOWN_FRACTION = 0.7;
+
+// Picks the analog input range from the amplitude of the signal. Levels are
+// ordered widest first. Every sample is checked against the current full
+// scale so that widening never waits, while narrowing looks at the peak of
+// whole blocks and needs hold_blocks quiet blocks in a row. Runs on the
+// real-time thread.
+template<size_t BlockSize = AUTO_RANGE_BLOCK_SIZE>
+class auto_ranger
+{
+public:
+  void configure(const double* full_scales,
+                 size_t level_count,
+                 uint64_t hold_blocks)
+  {
+    count = level_count < MAX_AUTO_RANGES ? level_count : MAX_AUTO_RANGES;
+    for (size_t index = 0; index < count; ++index) {
+      full_scale[index] = full_scales[index];
+    }
+    hold = hold_blocks > 0 ? hold_blocks : 1;
+    set_level(0);
+  }
+
+  // Starts over from a level chosen elsewhere, e.g. by a mode change
+  void set_level(size_t new_level)
+  {
+    current = new_level < count ? new_level : 0;
+    fill = 0;
+    quiet = 0;
+  }
+
+  size_t level() const { return current; }
+  size_t levels() const { return count; }
+
+  // Feeds one sample in volts at the converter and returns the level the
+  // channel should be on
+  size_t push(double sample)
+  {
+    if (count == 0) {
+      return current;
+    }
+    const double magnitude = std::fabs(sample);
+    if (magnitude > AUTO_RANGE_UP_FRACTION * full_scale[current]) {
+      // Narrowest wider range that holds the sample, or the widest one
+      size_t wider = current;
+      while (wider > 0) {
+        --wider;
+        if (magnitude <= AUTO_RANGE_UP_FRACTION * full_scale[wider]) {
+          break;
+        }
+      }
+      set_level(wider);
+      return current;
+    }
+    block[fill++] = sample;
+    if (fill < BlockSize) {
+      return current;
+    }
+    fill = 0;
+    const double peak = block_max_abs(block.data(), BlockSize);
+    if (current + 1 < count
+        && peak < AUTO_RANGE_DOWN_FRACTION * full_scale[current + 1])
+    {
+      if (++quiet >= hold) {
+        set_level(current + 1);
+      }
+    } else {
+      quiet = 0;
+    }
+    return current;
+  }
+
+private:
+  std::array<double, BlockSize> block {};
+  std::array<double, MAX_AUTO_RANGES> full_scale {};
+  size_t count = 0;
+  size_t current = 0;
+  size_t fill = 0;
+  uint64_t hold = 1;
+  uint64_t quiet = 0;
+};
+
+}  // namespace am_amp2400
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "amp_math.hpp"
+
+namespace am_amp2400
+{
+
+// Most samples on either side of a step edge used to estimate the jump
+constexpr size_t MAX_BRIDGE_ONSET_SAMPLES = 32;
+
+struct bridge_estimate
+{
+  bool valid;
+  // Ohms
+  double access_resistance;
+  // Instantaneous voltage jump for one step (V)
+  double voltage_jump;
+  uint64_t edges;
+};
+
+// Injects a train of current steps and measures the instantaneous voltage
+// jump at every edge, which is the drop across the access resistance.
+// Each cycle holds for step_samples, then steps for step_samples. The
+// samples around every edge are folded into preallocated windows, with
+// falling edges negated so that both directions add up. When the train is
+// done, a line is fitted before and after the edge. The gap between the
+// two lines at the edge is the jump, free of the slower membrane charging.
+// Runs on the real-time thread.
+class bridge_balance
+{
+public:
+  // amplitude is in output units, step_current is the same step in A
+  void start(size_t step_samples,
+             double amplitude,
+             double step_current,
+             uint64_t steps,
+             size_t onset_samples)
+  {
+    half = step_samples < 4 ? 4 : step_samples;
+    onset = onset_samples < 2 ? 2 : onset_samples;
+    onset = onset < MAX_BRIDGE_ONSET_SAMPLES ? onset : MAX_BRIDGE_ONSET_SAMPLES;
+    onset = onset <= half / 2 ? onset : half / 2;
+    step_amplitude = amplitude;
+    current = step_current;
+    total_cycles = steps > 0 ? steps : 1;
+    before.fill(0.0);
+    after.fill(0.0);
+    phase = 0;
+    cycle = 0;
+    running = true;
+  }
+
+  void stop() { running = false; }
+  bool active() const { return running; }
+
+  double output() const
+  {
+    return running && cycle < total_cycles && phase >= half ? step_amplitude
+                                                            : 0.0;
+  }
+
+  // Returns true once the last edge has been sampled
+  bool push(double potential)
+  {
+    if (!running) {
+      return false;
+    }
+    const bool stepping = phase >= half;
+    const size_t offset = stepping ? phase - half : phase;
+    // A rising edge leads into the step, a falling one out of it
+    const double after_sign = stepping ? 1.0 : -1.0;
+    if (offset < onset && (cycle > 0 || stepping)) {
+      after[offset] += after_sign * potential;
+    }
+    if (offset >= half - onset && cycle < total_cycles) {
+      before[offset - (half - onset)] -= after_sign * potential;
+    }
+    if (++phase == 2 * half) {
+      phase = 0;
+      ++cycle;
+    }
+    if (cycle == total_cycles && phase == onset) {
+      running = false;
+      return true;
+    }
+    return false;
+  }
+
+  bridge_estimate estimate() const
+  {
+    bridge_estimate result {};
+    result.edges = 2 * total_cycles;
+    const double scale = 1.0 / double(result.edges);
+    std::array<double, MAX_BRIDGE_ONSET_SAMPLES> before_mean {};
+    std::array<double, MAX_BRIDGE_ONSET_SAMPLES> after_mean {};
+    for (size_t index = 0; index < onset; ++index) {
+      before_mean[index] = before[index] * scale;
+      after_mean[index] = after[index] * scale;
+    }
+    // The edge sits at x = 0, between the last sample before it and the
+    // first one after it
+    const line_fit pre = fit_line(before_mean.data(), onset, -double(onset));
+    const line_fit post = fit_line(after_mean.data(), onset, 0.0);
+    result.voltage_jump = post.intercept - pre.intercept;
+    if (current != 0.0) {
+      result.access_resistance = result.voltage_jump / current;
+      result.valid = result.access_resistance > 0.0;
+    }
+    return result;
+  }
+
+private:
+  std::array<double, MAX_BRIDGE_ONSET_SAMPLES> before {};
+  std::array<double, MAX_BRIDGE_ONSET_SAMPLES> after {};
+  size_t half = 4;
+  size_t onset = 2;
+  size_t phase = 0;
+  uint64_t cycle = 0;
+  uint64_t total_cycles = 1;
+  double step_amplitude = 0.0;
+  double current = 0.0;
+  bool running = false;
+};
+
+}  // namespace am_amp2400
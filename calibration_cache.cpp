@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <cmath>
+#include <string_view>
+#include <utility>
+
+#include "calibration_cache.hpp"
+
+namespace
+{
+// Version 1 keyed AI offsets without the AO channel of the loop, version
+// 2 also held the loop gain
+constexpr am_amp2400::file_header CALIBRATION_HEADER = {
+    {'A', 'M', '2', '4', 'C', 'A', 'L', 'B'},
+    3,
+    sizeof(am_amp2400::calibration_record)};
+
+bool matches(const am_amp2400::calibration_record& record,
+             const std::string& device,
+             size_t input_channel,
+             size_t output_channel,
+             size_t ai_range)
+{
+  using am_amp2400::CALIBRATION_DEVICE_NAME_SIZE;
+  return record.used != 0 && record.input_channel == input_channel
+      && record.output_channel == output_channel && record.ai_range == ai_range
+      && std::string_view(device).substr(0, CALIBRATION_DEVICE_NAME_SIZE - 1)
+      == record.device.data();
+}
+}  // namespace
+
+bool am_amp2400::calibration_cache::load(const std::string& path)
+{
+  return load_file(
+      path,
+      CALIBRATION_HEADER,
+      contents,
+      [](calibration_file& file)
+      {
+        // Never trust the name terminator or the values read from disk
+        for (auto& record : file.records) {
+          record.device.back() = '\0';
+          if (!std::isfinite(record.loop_offset)) {
+            record.used = 0;
+          }
+        }
+      });
+}
+
+bool am_amp2400::calibration_cache::save(const std::string& path) const
+{
+  return save_file(path, CALIBRATION_HEADER, contents);
+}
+
+void am_amp2400::calibration_cache::store(const std::string& device,
+                                          size_t input_channel,
+                                          size_t output_channel,
+                                          size_t ai_range,
+                                          double loop_offset,
+                                          int64_t time)
+{
+  calibration_record* record =
+      find_slot(device, input_channel, output_channel, ai_range);
+  if (record == nullptr) {
+    // Unused records have used == 0 and time == 0, so they go first
+    record = &*std::min_element(
+        contents.records.begin(),
+        contents.records.end(),
+        [](const calibration_record& first, const calibration_record& second)
+        {
+          return std::make_pair(first.used, first.time)
+              < std::make_pair(second.used, second.time);
+        });
+  }
+  *record = calibration_record {};
+  std::copy_n(device.begin(),
+              std::min(device.size(), CALIBRATION_DEVICE_NAME_SIZE - 1),
+              record->device.begin());
+  record->used = 1;
+  record->input_channel = input_channel;
+  record->output_channel = output_channel;
+  record->ai_range = ai_range;
+  record->loop_offset = loop_offset;
+  record->time = time;
+}
+
+void am_amp2400::calibration_cache::clear(const std::string& device,
+                                          size_t input_channel,
+                                          size_t output_channel,
+                                          size_t ai_range)
+{
+  calibration_record* record =
+      find_slot(device, input_channel, output_channel, ai_range);
+  if (record != nullptr) {
+    *record = calibration_record {};
+  }
+}
+
+const am_amp2400::calibration_record* am_amp2400::calibration_cache::find(
+    const std::string& device,
+    size_t input_channel,
+    size_t output_channel,
+    size_t ai_range) const
+{
+  for (const auto& record : contents.records) {
+    if (matches(record, device, input_channel, output_channel, ai_range)) {
+      return &record;
+    }
+  }
+  return nullptr;
+}
+
+am_amp2400::calibration_record* am_amp2400::calibration_cache::find_slot(
+    const std::string& device,
+    size_t input_channel,
+    size_t output_channel,
+    size_t ai_range)
+{
+  return const_cast<calibration_record*>(
+      static_cast<const calibration_cache*>(this)->find(
+          device, input_channel, output_channel, ai_range));
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "mapped_file.hpp"
+
+namespace am_amp2400
+{
+
+// Number of loop and range combinations the cache remembers
+constexpr size_t MAX_CALIBRATIONS = 256;
+constexpr size_t CALIBRATION_DEVICE_NAME_SIZE = 64;
+
+// Loopback calibration of one AO channel wired to one AI channel of a
+// device, at one AI range. The record is written to disk as is, so it only
+// holds fixed size fields.
+struct calibration_record
+{
+  std::array<char, CALIBRATION_DEVICE_NAME_SIZE> device;
+  uint32_t used;
+  uint64_t input_channel;
+  uint64_t output_channel;
+  uint64_t ai_range;
+  // AI reading with the AO channel at zero and both channels at unity
+  // gain, i.e. the AO offset plus the AI offset in volts
+  double loop_offset;
+  // RT::OS::getTime() of the measurement
+  int64_t time;
+};
+
+// On-disk layout of the cache, same scheme as the preset file
+struct calibration_file
+{
+  file_header header;
+  std::array<calibration_record, MAX_CALIBRATIONS> records;
+};
+
+static_assert(std::is_trivially_copyable_v<calibration_file>,
+              "calibrations are written and mapped byte for byte");
+
+// Loop corrections keyed by device name, AI channel, AO channel and AI
+// range, kept in memory and persisted like the preset bank. Looking one up
+// never touches the disk.
+class calibration_cache
+{
+public:
+  // Returns false and leaves the cache empty if the file is missing or was
+  // written by an incompatible version.
+  bool load(const std::string& path);
+  bool save(const std::string& path) const;
+
+  // Replaces the record with the same key. The oldest record makes room
+  // when the cache is full.
+  void store(const std::string& device,
+             size_t input_channel,
+             size_t output_channel,
+             size_t ai_range,
+             double loop_offset,
+             int64_t time);
+  void clear(const std::string& device,
+             size_t input_channel,
+             size_t output_channel,
+             size_t ai_range);
+
+  // nullptr when the loop was never calibrated at this range
+  const calibration_record* find(const std::string& device,
+                                 size_t input_channel,
+                                 size_t output_channel,
+                                 size_t ai_range) const;
+
+private:
+  calibration_record* find_slot(const std::string& device,
+                                size_t input_channel,
+                                size_t output_channel,
+                                size_t ai_range);
+
+  calibration_file contents {};
+};
+
+}  // namespace am_amp2400
@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "control_server.hpp"
+
+namespace
+{
+// Longest request line kept before the client is dropped
+constexpr size_t MAX_REQUEST_SIZE = 64 * 1024;
+
+// Clears the way for binding address. A socket file nobody listens on was
+// left behind by a crashed session and is removed. Returns why the path
+// cannot be used otherwise, e.g. another instance serving it.
+std::string claim_path(const sockaddr_un& address)
+{
+  struct stat info {};
+  if (::lstat(address.sun_path, &info) != 0) {
+    return errno == ENOENT ? std::string() : std::strerror(errno);
+  }
+  if (!S_ISSOCK(info.st_mode)) {
+    return "path exists and is not a socket";
+  }
+  const int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (probe < 0) {
+    return std::strerror(errno);
+  }
+  const bool answered = ::connect(probe,
+                                  reinterpret_cast<const sockaddr*>(&address),
+                                  sizeof(address))
+      == 0;
+  const int error = errno;
+  ::close(probe);
+  if (answered) {
+    return "path is already in use by another instance";
+  }
+  if (error != ECONNREFUSED && error != ENOENT) {
+    return std::strerror(error);
+  }
+  ::unlink(address.sun_path);
+  return {};
+}
+}  // namespace
+
+std::string am_amp2400::control_server::start(const std::string& path,
+                                              request_handler handler)
+{
+  stop();
+  sockaddr_un address {};
+  if (path.size() >= sizeof(address.sun_path)) {
+    return "path is too long";
+  }
+  address.sun_family = AF_UNIX;
+  std::copy(path.begin(), path.end(), address.sun_path);
+  std::string error = claim_path(address);
+  if (!error.empty()) {
+    return error;
+  }
+
+  listen_descriptor = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listen_descriptor < 0) {
+    return std::strerror(errno);
+  }
+  const mode_t previous_mask = ::umask(0077);
+  const bool bound = ::bind(listen_descriptor,
+                            reinterpret_cast<const sockaddr*>(&address),
+                            sizeof(address))
+      == 0;
+  ::umask(previous_mask);
+  if (!bound || ::listen(listen_descriptor, 8) != 0
+      || ::pipe2(wake_pipe.data(), O_CLOEXEC | O_NONBLOCK) != 0)
+  {
+    error = std::strerror(errno);
+    ::close(listen_descriptor);
+    listen_descriptor = -1;
+    return error;
+  }
+  socket_path = path;
+  on_request = std::move(handler);
+  serving = true;
+  thread = std::thread(&am_amp2400::control_server::serve, this);
+  return {};
+}
+
+void am_amp2400::control_server::stop()
+{
+  if (!thread.joinable()) {
+    return;
+  }
+  serving = false;
+  const char wake = 0;
+  (void)::write(wake_pipe[1], &wake, 1);
+  thread.join();
+  for (auto& client : clients) {
+    ::close(client.descriptor);
+  }
+  clients.clear();
+  ::close(listen_descriptor);
+  ::close(wake_pipe[0]);
+  ::close(wake_pipe[1]);
+  listen_descriptor = -1;
+  wake_pipe = {-1, -1};
+  ::unlink(socket_path.c_str());
+  const std::lock_guard<std::mutex> lock(replies_mutex);
+  pending_replies.clear();
+}
+
+void am_amp2400::control_server::reply(uint64_t client, std::string text)
+{
+  {
+    const std::lock_guard<std::mutex> lock(replies_mutex);
+    pending_replies.emplace_back(client, std::move(text));
+  }
+  const char wake = 0;
+  (void)::write(wake_pipe[1], &wake, 1);
+}
+
+void am_amp2400::control_server::serve()
+{
+  std::vector<pollfd> descriptors;
+  while (serving) {
+    descriptors.clear();
+    descriptors.push_back({wake_pipe[0], POLLIN, 0});
+    descriptors.push_back({listen_descriptor, POLLIN, 0});
+    for (const auto& client : clients) {
+      const short events =
+          client.output.empty() ? POLLIN : static_cast<short>(POLLIN | POLLOUT);
+      descriptors.push_back({client.descriptor, events, 0});
+    }
+    if (::poll(descriptors.data(), descriptors.size(), -1) < 0) {
+      continue;
+    }
+    if ((descriptors[0].revents & POLLIN) != 0) {
+      char drain[64];
+      while (::read(wake_pipe[0], drain, sizeof(drain)) > 0) {
+      }
+      collectReplies();
+    }
+    if ((descriptors[1].revents & POLLIN) != 0) {
+      acceptClient();
+    }
+    // Clients accepted above are not in descriptors yet
+    const size_t polled = descriptors.size() - 2;
+    std::vector<uint64_t> closed;
+    for (size_t index = 0; index < polled; ++index) {
+      connection& client = clients[index];
+      const short events = descriptors[index + 2].revents;
+      bool open = true;
+      if ((events & (POLLIN | POLLHUP | POLLERR)) != 0) {
+        open = readClient(client);
+      }
+      if (open && (events & POLLOUT) != 0) {
+        open = flushClient(client);
+      }
+      if (!open) {
+        closed.push_back(client.id);
+      }
+    }
+    for (const uint64_t id : closed) {
+      const auto client = findClient(id);
+      ::close(client->descriptor);
+      clients.erase(client);
+    }
+  }
+}
+
+void am_amp2400::control_server::acceptClient()
+{
+  const int descriptor = ::accept4(
+      listen_descriptor, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+  if (descriptor >= 0) {
+    clients.push_back({descriptor, next_client++, {}, {}});
+  }
+}
+
+// Hands every complete line to the handler. Returns false once the client
+// hung up or misbehaved.
+bool am_amp2400::control_server::readClient(connection& client)
+{
+  char buffer[4096];
+  const ssize_t received =
+      ::recv(client.descriptor, buffer, sizeof(buffer), 0);
+  if (received <= 0) {
+    return received < 0 && (errno == EAGAIN || errno == EINTR);
+  }
+  client.input.append(buffer, static_cast<size_t>(received));
+  size_t end = 0;
+  while ((end = client.input.find('\n')) != std::string::npos) {
+    on_request(client.id, client.input.substr(0, end));
+    client.input.erase(0, end + 1);
+  }
+  return client.input.size() <= MAX_REQUEST_SIZE;
+}
+
+bool am_amp2400::control_server::flushClient(connection& client)
+{
+  const ssize_t sent = ::send(client.descriptor,
+                              client.output.data(),
+                              client.output.size(),
+                              MSG_NOSIGNAL);
+  if (sent < 0) {
+    return errno == EAGAIN || errno == EINTR;
+  }
+  client.output.erase(0, static_cast<size_t>(sent));
+  return true;
+}
+
+std::vector<am_amp2400::control_server::connection>::iterator
+am_amp2400::control_server::findClient(uint64_t id)
+{
+  return std::find_if(clients.begin(),
+                      clients.end(),
+                      [id](const connection& client)
+                      { return client.id == id; });
+}
+
+void am_amp2400::control_server::collectReplies()
+{
+  std::vector<std::pair<uint64_t, std::string>> replies;
+  {
+    const std::lock_guard<std::mutex> lock(replies_mutex);
+    replies.swap(pending_replies);
+  }
+  for (auto& [id, text] : replies) {
+    const auto client = findClient(id);
+    if (client != clients.end()) {
+      client->output += text;
+      flushClient(*client);
+    }
+  }
+}
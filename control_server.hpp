@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace am_amp2400
+{
+
+// Serves newline terminated requests on a Unix domain socket. Every request
+// line is passed to the handler with the id of the client that sent it; the
+// answer is sent back later through reply(), from any thread. The socket is
+// served by its own thread, so a slow client never stalls the caller.
+class control_server
+{
+public:
+  using request_handler =
+      std::function<void(uint64_t client, const std::string& request)>;
+
+  control_server() = default;
+  control_server(const control_server&) = delete;
+  control_server(control_server&&) = delete;
+  control_server& operator=(const control_server&) = delete;
+  control_server& operator=(control_server&&) = delete;
+  ~control_server() { stop(); }
+
+  // The socket is only accessible to the current user. A path another
+  // instance is serving is left alone. Returns why listening failed, or an
+  // empty string.
+  std::string start(const std::string& path, request_handler handler);
+  void stop();
+  bool running() const { return thread.joinable(); }
+
+  // Replies to clients that disconnected in the meantime are dropped
+  void reply(uint64_t client, std::string text);
+
+private:
+  struct connection
+  {
+    int descriptor;
+    uint64_t id;
+    std::string input;
+    std::string output;
+  };
+
+  void serve();
+  void acceptClient();
+  bool readClient(connection& client);
+  static bool flushClient(connection& client);
+  void collectReplies();
+  std::vector<connection>::iterator findClient(uint64_t id);
+
+  request_handler on_request;
+  std::string socket_path;
+  int listen_descriptor = -1;
+  // Written by reply() to wake the serving thread up
+  std::array<int, 2> wake_pipe = {-1, -1};
+  std::thread thread;
+  std::atomic<bool> serving = false;
+  std::mutex replies_mutex;
+  std::vector<std::pair<uint64_t, std::string>> pending_replies;
+  // Only touched by the serving thread
+  std::vector<connection> clients;
+  uint64_t next_client = 1;
+};
+
+}  // namespace am_amp2400
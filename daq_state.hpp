@@ -0,0 +1,277 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <rtxi/daq.hpp>
+
+#include "amp_profile.hpp"
+
+namespace am_amp2400
+{
+
+// Number of amplifiers a single panel can drive
+constexpr size_t MAX_AMPLIFIERS = 4;
+
+// Channels and digital lines wired to one amplifier
+struct channel_map
+{
+  size_t input_channel;
+  size_t output_channel;
+  std::array<size_t, 3> telegraph_lines;
+};
+
+// Everything the panel keeps for one amplifier
+struct amp_config
+{
+  channel_map channels;
+  amp_mode mode;
+  probe_gain_t probe_gain;
+  double ai_offset;
+  double ao_offset;
+};
+
+constexpr bool operator==(const channel_map& first, const channel_map& second)
+{
+  return first.input_channel == second.input_channel
+      && first.output_channel == second.output_channel
+      && first.telegraph_lines == second.telegraph_lines;
+}
+
+constexpr bool operator==(const amp_config& first, const amp_config& second)
+{
+  return first.channels == second.channels && first.mode == second.mode
+      && first.probe_gain == second.probe_gain
+      && first.ai_offset == second.ai_offset
+      && first.ao_offset == second.ao_offset;
+}
+
+constexpr amp_config DEFAULT_AMP_CONFIG = {{0, 0, {0, 0, 0}}, IEQ0, LOW, 0, 0};
+
+// Complete channel configuration for one amplifier: which channels and
+// lines it uses and the values they should hold. Plain aggregate so that it
+// can travel inside the fifo messages.
+struct daq_state
+{
+  amp_mode mode;
+  double probe_gain_factor;
+  size_t input_channel;
+  size_t output_channel;
+  std::array<size_t, 3> telegraph_lines;
+  size_t ai_range;
+  double ai_gain;
+  double ai_offset;
+  double ao_gain;
+  double ao_offset;
+  std::array<double, 3> telegraph;
+};
+
+// Resolves a mode into the channel configuration the device should end up
+// with. Does not depend on Qt or on a real device, so the whole path from
+// mode to device calls can be driven by any type providing the DAQ::Device
+// setters (see daq_shadow::apply).
+template<class Profile>
+constexpr daq_state make_daq_state(amp_mode mode,
+                                   double probe_gain_factor,
+                                   const channel_map& channels,
+                                   double ai_offset,
+                                   double ao_offset)
+{
+  const resolved_settings settings =
+      resolve_mode<Profile>(mode, probe_gain_factor);
+  return {mode,
+          probe_gain_factor,
+          channels.input_channel,
+          channels.output_channel,
+          channels.telegraph_lines,
+          settings.ai_range,
+          settings.ai_gain,
+          ai_offset,
+          settings.ao_gain,
+          ao_offset,
+          settings.telegraph};
+}
+
+template<class Profile>
+constexpr daq_state make_daq_state(const amp_config& config)
+{
+  return make_daq_state<Profile>(
+      config.mode,
+      probe_gain_factor_for<Profile>(config.probe_gain),
+      config.channels,
+      config.ai_offset,
+      config.ao_offset);
+}
+
+// Number of device calls made and avoided by daq_shadow::apply
+struct apply_stats
+{
+  uint64_t issued;
+  uint64_t skipped;
+};
+
+// Default observer for daq_shadow::apply
+struct no_observer
+{
+  void operator()() const {}
+};
+
+// Remembers what was last written to a device so that re-applying a state
+// only issues the calls whose values changed. Some DAQ drivers reprogram
+// the whole channel list on every setter, which makes redundant calls
+// expensive.
+class daq_shadow
+{
+public:
+  // Forget everything, e.g. when the device changes or another plugin may
+  // have touched the channels.
+  void invalidate()
+  {
+    ai_valid = false;
+    ao_valid = false;
+    telegraph_valid = {false, false, false};
+  }
+
+  // Device only needs the setAnalog* and writeinput calls of DAQ::Device.
+  // The observer is invoked right after every call that reaches the device,
+  // which lets callers time the individual setters.
+  template<class Device, class Observer = no_observer>
+  void apply(Device& device,
+             const daq_state& target,
+             apply_stats& stats,
+             const Observer& observer = Observer {})
+  {
+    // Settings cached for one channel say nothing about another one
+    if (target.input_channel != applied.input_channel) {
+      ai_valid = false;
+    }
+    if (target.output_channel != applied.output_channel) {
+      ao_valid = false;
+    }
+
+    const bool new_ai_range = !ai_valid || target.ai_range != applied.ai_range;
+    issue(new_ai_range, stats, observer, [&]() {
+      device.setAnalogRange(
+          DAQ::ChannelType::AI, target.input_channel, target.ai_range);
+    });
+    const bool new_ai_gain = !ai_valid || target.ai_gain != applied.ai_gain;
+    issue(new_ai_gain, stats, observer, [&]() {
+      device.setAnalogGain(
+          DAQ::ChannelType::AI, target.input_channel, target.ai_gain);
+    });
+    const bool new_ai_offset =
+        !ai_valid || target.ai_offset != applied.ai_offset;
+    issue(new_ai_offset, stats, observer, [&]() {
+      device.setAnalogZeroOffset(
+          DAQ::ChannelType::AI, target.input_channel, target.ai_offset);
+    });
+    const bool new_ao_gain = !ao_valid || target.ao_gain != applied.ao_gain;
+    issue(new_ao_gain, stats, observer, [&]() {
+      device.setAnalogGain(
+          DAQ::ChannelType::AO, target.output_channel, target.ao_gain);
+    });
+    const bool new_ao_offset =
+        !ao_valid || target.ao_offset != applied.ao_offset;
+    issue(new_ao_offset, stats, observer, [&]() {
+      device.setAnalogZeroOffset(
+          DAQ::ChannelType::AO, target.output_channel, target.ao_offset);
+    });
+
+    for (size_t bit = 0; bit < target.telegraph.size(); ++bit) {
+      const bool new_level = !telegraph_valid[bit]
+          || target.telegraph_lines[bit] != applied.telegraph_lines[bit]
+          || target.telegraph[bit] != applied.telegraph[bit];
+      issue(new_level, stats, observer, [&]() {
+        device.writeinput(target.telegraph_lines[bit], target.telegraph[bit]);
+      });
+      telegraph_valid[bit] = true;
+    }
+
+    applied = target;
+    ai_valid = true;
+    ao_valid = true;
+  }
+
+  const daq_state& state() const { return applied; }
+
+  // True once a full state has been applied through this shadow
+  bool valid() const { return ai_valid && ao_valid; }
+
+private:
+  template<class Observer, class Call>
+  static void issue(bool changed,
+                    apply_stats& stats,
+                    const Observer& observer,
+                    const Call& call)
+  {
+    if (changed) {
+      call();
+      observer();
+      ++stats.issued;
+    } else {
+      ++stats.skipped;
+    }
+  }
+
+  daq_state applied {};
+  bool ai_valid = false;
+  bool ao_valid = false;
+  std::array<bool, 3> telegraph_valid = {false, false, false};
+};
+
+// Channel settings that can be read back from a device, as bits of the mask
+// returned by find_mismatches
+enum daq_setting : uint32_t
+{
+  AI_RANGE_SETTING = 1U << 0,
+  AI_GAIN_SETTING = 1U << 1,
+  AI_OFFSET_SETTING = 1U << 2,
+  AO_GAIN_SETTING = 1U << 3,
+  AO_OFFSET_SETTING = 1U << 4
+};
+
+// Reads the analog settings of the channels in state back from the device
+// and returns the ones that differ. Costs five getter calls. Telegraph lines
+// are outputs and cannot be read back.
+template<class Device>
+uint32_t find_mismatches(const Device& device, const daq_state& state)
+{
+  // Drivers may store the values in lower precision
+  const auto differs = [](double actual, double expected)
+  {
+    return !(std::abs(actual - expected) <= 1e-6 * std::abs(expected) + 1e-12);
+  };
+  uint32_t mismatches = 0;
+  if (device.getAnalogRange(DAQ::ChannelType::AI, state.input_channel)
+      != state.ai_range)
+  {
+    mismatches |= AI_RANGE_SETTING;
+  }
+  if (differs(device.getAnalogGain(DAQ::ChannelType::AI, state.input_channel),
+              state.ai_gain))
+  {
+    mismatches |= AI_GAIN_SETTING;
+  }
+  if (differs(device.getAnalogZeroOffset(DAQ::ChannelType::AI,
+                                         state.input_channel),
+              state.ai_offset))
+  {
+    mismatches |= AI_OFFSET_SETTING;
+  }
+  if (differs(device.getAnalogGain(DAQ::ChannelType::AO, state.output_channel),
+              state.ao_gain))
+  {
+    mismatches |= AO_GAIN_SETTING;
+  }
+  if (differs(device.getAnalogZeroOffset(DAQ::ChannelType::AO,
+                                         state.output_channel),
+              state.ao_offset))
+  {
+    mismatches |= AO_OFFSET_SETTING;
+  }
+  return mismatches;
+}
+
+}  // namespace am_amp2400
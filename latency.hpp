@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace am_amp2400
+{
+
+// Histogram of latencies in nanoseconds. Buckets are log2 octaves split
+// into SUB_BUCKETS linear steps, which keeps the relative error of reported
+// percentiles under 1/SUB_BUCKETS. Recording only does relaxed atomic
+// increments, so it is safe to call from the real-time thread while the
+// GUI reads the percentiles.
+class latency_histogram
+{
+public:
+  static constexpr size_t SUB_BUCKET_BITS = 3;
+  static constexpr size_t SUB_BUCKETS = size_t {1} << SUB_BUCKET_BITS;
+  static constexpr size_t OCTAVES = 40;  // up to 2^42 ns, ~73 minutes
+  static constexpr size_t NUM_BUCKETS = OCTAVES * SUB_BUCKETS;
+
+  void record(int64_t latency_ns)
+  {
+    const uint64_t value = latency_ns > 0 ? uint64_t(latency_ns) : 0;
+    buckets[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    uint64_t current = max_ns.load(std::memory_order_relaxed);
+    while (value > current
+           && !max_ns.compare_exchange_weak(
+               current, value, std::memory_order_relaxed))
+    {
+    }
+  }
+
+  uint64_t count() const { return total.load(std::memory_order_relaxed); }
+
+  int64_t max() const
+  {
+    return static_cast<int64_t>(max_ns.load(std::memory_order_relaxed));
+  }
+
+  // Upper bound of the bucket holding the requested fraction (0..1) of the
+  // recorded values
+  int64_t percentile(double fraction) const
+  {
+    const uint64_t samples = count();
+    if (samples == 0) {
+      return 0;
+    }
+    auto rank = static_cast<uint64_t>(fraction * double(samples));
+    rank = rank < 1 ? 1 : rank;
+    uint64_t seen = 0;
+    for (size_t index = 0; index < NUM_BUCKETS; ++index) {
+      seen += buckets[index].load(std::memory_order_relaxed);
+      if (seen >= rank) {
+        const auto upper = static_cast<int64_t>(bucket_upper_bound(index));
+        return upper < max() ? upper : max();
+      }
+    }
+    return max();
+  }
+
+private:
+  static size_t bucket_index(uint64_t value)
+  {
+    if (value < SUB_BUCKETS) {
+      return static_cast<size_t>(value);
+    }
+    const size_t msb = 63 - static_cast<size_t>(__builtin_clzll(value));
+    const size_t octave = msb - SUB_BUCKET_BITS + 1;
+    const size_t sub = (value >> (msb - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    const size_t index = octave * SUB_BUCKETS + sub;
+    return index < NUM_BUCKETS ? index : NUM_BUCKETS - 1;
+  }
+
+  static uint64_t bucket_upper_bound(size_t index)
+  {
+    const size_t octave = index / SUB_BUCKETS;
+    const uint64_t sub = index % SUB_BUCKETS;
+    if (octave == 0) {
+      return sub;
+    }
+    const size_t shift = octave - 1;
+    return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+  }
+
+  std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets {};
+  std::atomic<uint64_t> total = 0;
+  std::atomic<uint64_t> max_ns = 0;
+};
+
+// Latencies of the Set DAQ path, from the panel slot to the last telegraph
+// level handed to the device.
+struct apply_latency
+{
+  // Panel::modify to the start of the apply on the real-time side
+  latency_histogram dispatch;
+  // Duration of each individual device setter or telegraph write
+  latency_histogram setter;
+  // Panel::modify to the last telegraph write
+  latency_histogram total;
+};
+
+}  // namespace am_amp2400
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+namespace am_amp2400
+{
+
+// Most second order sections in the filter chain
+constexpr size_t MAX_FILTER_SECTIONS = 8;
+// The low-pass is a 4th order Butterworth, i.e. two sections with these
+// quality factors
+constexpr std::array<double, 2> BUTTERWORTH_Q = {0.54119610014619698,
+                                                 1.3065629648763766};
+constexpr size_t MAX_LINE_HARMONICS =
+    MAX_FILTER_SECTIONS - BUTTERWORTH_Q.size();
+
+// Second order section normalised so that a0 = 1
+struct biquad
+{
+  double b0;
+  double b1;
+  double b2;
+  double a1;
+  double a2;
+};
+
+// Designs from the bilinear transform with prewarping (RBJ cookbook)
+inline biquad notch_biquad(double frequency, double q, double sample_rate)
+{
+  const double omega = 2.0 * M_PI * frequency / sample_rate;
+  const double cos_omega = std::cos(omega);
+  const double alpha = std::sin(omega) / (2.0 * q);
+  const double a0 = 1.0 + alpha;
+  return {1.0 / a0,
+          -2.0 * cos_omega / a0,
+          1.0 / a0,
+          -2.0 * cos_omega / a0,
+          (1.0 - alpha) / a0};
+}
+
+inline biquad lowpass_biquad(double frequency, double q, double sample_rate)
+{
+  const double omega = 2.0 * M_PI * frequency / sample_rate;
+  const double cos_omega = std::cos(omega);
+  const double alpha = std::sin(omega) / (2.0 * q);
+  const double a0 = 1.0 + alpha;
+  return {(1.0 - cos_omega) / (2.0 * a0),
+          (1.0 - cos_omega) / a0,
+          (1.0 - cos_omega) / (2.0 * a0),
+          -2.0 * cos_omega / a0,
+          (1.0 - alpha) / a0};
+}
+
+// Notches at line_frequency and its next harmonics - 1 multiples, followed
+// by the low-pass when lowpass_cutoff is above 0. Frequencies at or above
+// the Nyquist frequency are left out. Returns the number of sections.
+inline size_t design_line_filter(
+    double line_frequency,
+    size_t harmonics,
+    double notch_q,
+    double lowpass_cutoff,
+    double sample_rate,
+    std::array<biquad, MAX_FILTER_SECTIONS>& sections)
+{
+  const double nyquist = sample_rate / 2.0;
+  size_t count = 0;
+  harmonics = harmonics < MAX_LINE_HARMONICS ? harmonics : MAX_LINE_HARMONICS;
+  for (size_t harmonic = 1; harmonic <= harmonics; ++harmonic) {
+    const double frequency = line_frequency * double(harmonic);
+    if (frequency > 0.0 && frequency < nyquist && notch_q > 0.0) {
+      sections[count++] = notch_biquad(frequency, notch_q, sample_rate);
+    }
+  }
+  if (lowpass_cutoff > 0.0 && lowpass_cutoff < nyquist) {
+    for (const double q : BUTTERWORTH_Q) {
+      sections[count++] = lowpass_biquad(lowpass_cutoff, q, sample_rate);
+    }
+  }
+  return count;
+}
+
+// Cascade of biquads in transposed direct form II, one sample per period.
+// Each section feeds the next within the sample, so the work is a short
+// dependent chain of multiply-adds with nothing to allocate. The state is
+// primed with the first sample as a steady input, so a large DC level
+// (e.g. a resting potential) does not ring through the chain.
+class biquad_chain
+{
+public:
+  void configure(const biquad* designs, size_t section_count)
+  {
+    count = section_count < MAX_FILTER_SECTIONS ? section_count
+                                                : MAX_FILTER_SECTIONS;
+    for (size_t index = 0; index < count; ++index) {
+      sections[index] = designs[index];
+    }
+    reset();
+  }
+
+  void reset() { primed = false; }
+
+  double push(double sample)
+  {
+    if (!primed) {
+      prime(sample);
+    }
+    double value = sample;
+    for (size_t index = 0; index < count; ++index) {
+      const biquad& section = sections[index];
+      const double output = section.b0 * value + state1[index];
+      state1[index] = section.b1 * value - section.a1 * output + state2[index];
+      state2[index] = section.b2 * value - section.a2 * output;
+      value = output;
+    }
+    return value;
+  }
+
+private:
+  // States of every section holding a constant input forever
+  void prime(double input)
+  {
+    double value = input;
+    for (size_t index = 0; index < count; ++index) {
+      const biquad& section = sections[index];
+      const double gain = (section.b0 + section.b1 + section.b2)
+          / (1.0 + section.a1 + section.a2);
+      const double output = gain * value;
+      state2[index] = section.b2 * value - section.a2 * output;
+      state1[index] = section.b1 * value - section.a1 * output + state2[index];
+      value = output;
+    }
+    primed = true;
+  }
+
+  std::array<biquad, MAX_FILTER_SECTIONS> sections {};
+  std::array<double, MAX_FILTER_SECTIONS> state1 {};
+  std::array<double, MAX_FILTER_SECTIONS> state2 {};
+  size_t count = 0;
+  bool primed = false;
+};
+
+}  // namespace am_amp2400
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace am_amp2400
+{
+
+// Keeps the producer and consumer indices on separate cache lines
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+// Wait-free ring for exactly one producer thread and one consumer thread.
+// Each side only writes its own index, so neither ever blocks or retries,
+// which makes it safe to drain from the real-time thread.
+template<class T, size_t Capacity>
+class spsc_ring
+{
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                "capacity must be a power of two");
+  static_assert(std::is_trivially_copyable_v<T>,
+                "items are copied in and out of the ring");
+
+public:
+  // Producer side. Returns false when the ring is full.
+  bool try_push(const T& item)
+  {
+    const size_t head = write_index.load(std::memory_order_relaxed);
+    if (head - cached_read_index == Capacity) {
+      cached_read_index = read_index.load(std::memory_order_acquire);
+      if (head - cached_read_index == Capacity) {
+        return false;
+      }
+    }
+    buffer[head & (Capacity - 1)] = item;
+    write_index.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns false when the ring is empty.
+  bool try_pop(T& item)
+  {
+    const size_t tail = read_index.load(std::memory_order_relaxed);
+    if (tail == cached_write_index) {
+      cached_write_index = write_index.load(std::memory_order_acquire);
+      if (tail == cached_write_index) {
+        return false;
+      }
+    }
+    item = buffer[tail & (Capacity - 1)];
+    read_index.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> write_index = 0;
+  size_t cached_read_index = 0;
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> read_index = 0;
+  size_t cached_write_index = 0;
+  alignas(CACHE_LINE_SIZE) std::array<T, Capacity> buffer {};
+};
+
+// Publishes a value from one writer to any number of readers. Writers never
+// wait; readers retry only if a write lands while they copy. The value is
+// stored as atomic words so that a torn read is detected rather than being
+// a data race.
+template<class T>
+class seqlock
+{
+  static_assert(std::is_trivially_copyable_v<T>,
+                "values are copied word by word");
+
+public:
+  seqlock() { publish(T {}); }
+
+  // Writer side, a single thread only
+  void publish(const T& value) { publish(value, sizeof(T)); }
+
+  // Like publish, but stores only the first bytes of value, e.g. the part
+  // of a large buffer in use, so the cost follows bytes rather than the
+  // size of T. Readers get the rest as it was last published.
+  void publish(const T& value, size_t bytes)
+  {
+    const auto* source = reinterpret_cast<const unsigned char*>(&value);
+    const size_t count = bytes < sizeof(T) ? (bytes + 7) / 8 : WORDS;
+    const uint64_t start = sequence.load(std::memory_order_relaxed);
+    sequence.store(start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t index = 0; index < count; ++index) {
+      const size_t offset = index * 8;
+      uint64_t word = 0;
+      std::memcpy(&word,
+                  source + offset,
+                  sizeof(T) - offset < 8 ? sizeof(T) - offset : 8);
+      storage[index].store(word, std::memory_order_relaxed);
+    }
+    sequence.store(start + 2, std::memory_order_release);
+  }
+
+  // Copies the value if it changed since version, which is updated.
+  // Returns false when there is nothing new or a write was in progress, in
+  // which case the caller can simply try again on its next period.
+  bool read_if_newer(T& value, uint64_t& version) const
+  {
+    const uint64_t before = sequence.load(std::memory_order_acquire);
+    if (before == version || (before & 1) != 0) {
+      return false;
+    }
+    std::array<uint64_t, WORDS> words {};
+    for (size_t index = 0; index < WORDS; ++index) {
+      words[index] = storage[index].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence.load(std::memory_order_relaxed) != before) {
+      return false;
+    }
+    std::memcpy(&value, words.data(), sizeof(T));
+    version = before;
+    return true;
+  }
+
+private:
+  static constexpr size_t WORDS = (sizeof(T) + 7) / 8;
+  std::atomic<uint64_t> sequence = 0;
+  std::array<std::atomic<uint64_t>, WORDS> storage {};
+};
+
+}  // namespace am_amp2400
@@ -0,0 +1,112 @@
+// Prints the amplifier state log written by the am-amp2400 plugin. With
+// --merge, the lines of a text file whose first field is a timestamp in ns
+// (e.g. an export of recorded data) are interleaved with the log by time.
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "amp_profile.hpp"
+#include "state_log.hpp"
+
+namespace
+{
+constexpr std::array<const char*, am_amp2400::NUM_AMP_MODES> MODE_NAMES = {
+    "VClamp", "I=0", "IClamp", "VComp", "VTest", "IResist", "IFollow"};
+
+constexpr std::array<const char*, 8> SOURCE_NAMES = {
+    "set-daq", "scheduled", "drift", "panel",
+    "protocol", "watchdog", "calibration", "auto-range"};
+
+void print_entry(const am_amp2400::state_entry& entry)
+{
+  const auto source = static_cast<size_t>(entry.source);
+  std::printf(
+      "%lld amp=%u mode=%s source=%s probe_gain=%g ai_range=%u "
+      "ai_gain=%g ai_offset=%g ao_gain=%g ao_offset=%g "
+      "telegraph=%g,%g,%g\n",
+      static_cast<long long>(entry.time),
+      entry.amp + 1,
+      am_amp2400::valid_mode(entry.mode) ? MODE_NAMES[entry.mode] : "unknown",
+      source < SOURCE_NAMES.size() ? SOURCE_NAMES[source] : "unknown",
+      entry.probe_gain_factor,
+      entry.ai_range,
+      entry.ai_gain,
+      entry.ai_offset,
+      entry.ao_gain,
+      entry.ao_offset,
+      entry.telegraph[0],
+      entry.telegraph[1],
+      entry.telegraph[2]);
+}
+
+struct timed_line
+{
+  long long time;
+  std::string text;
+};
+
+// Lines without a leading timestamp (headers, comments) are echoed first
+bool read_timed_lines(const std::string& path, std::vector<timed_line>& out)
+{
+  std::ifstream file(path);
+  if (!file) {
+    return false;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    long long time = 0;
+    if (fields >> time) {
+      out.push_back({time, line});
+    } else {
+      std::printf("# %s\n", line.c_str());
+    }
+  }
+  return true;
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  if (argc != 2 && !(argc == 4 && std::string(argv[2]) == "--merge")) {
+    std::fprintf(stderr, "usage: %s LOG [--merge FILE]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  std::vector<am_amp2400::state_entry> entries;
+  if (!am_amp2400::state_log::read(argv[1], entries)) {
+    std::fprintf(stderr, "%s: unable to read state log %s\n", argv[0], argv[1]);
+    return EXIT_FAILURE;
+  }
+  std::vector<timed_line> lines;
+  if (argc == 4 && !read_timed_lines(argv[3], lines)) {
+    std::fprintf(stderr, "%s: unable to read %s\n", argv[0], argv[3]);
+    return EXIT_FAILURE;
+  }
+  // Entries from the real-time thread and the panel may be claimed slightly
+  // out of time order
+  std::stable_sort(entries.begin(),
+                   entries.end(),
+                   [](const auto& first, const auto& second)
+                   { return first.time < second.time; });
+  std::stable_sort(lines.begin(),
+                   lines.end(),
+                   [](const auto& first, const auto& second)
+                   { return first.time < second.time; });
+  size_t line = 0;
+  for (const auto& entry : entries) {
+    while (line < lines.size() && lines[line].time < entry.time) {
+      std::printf("%s\n", lines[line++].text.c_str());
+    }
+    print_entry(entry);
+  }
+  for (; line < lines.size(); ++line) {
+    std::printf("%s\n", lines[line].text.c_str());
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "amp_math.hpp"
+
+namespace am_amp2400
+{
+
+// Most output levels a loopback calibration steps through
+constexpr size_t MAX_LOOPBACK_LEVELS = 64;
+
+struct loopback_result
+{
+  bool valid;
+  // Input reading per unit of output, and the reading at zero output. The
+  // latter is the offset of the whole loop: the AO channel's offset plus
+  // the AI channel's, which one loop cannot tell apart.
+  double gain;
+  double loop_offset;
+  // Largest distance of a level from the fitted line, in input units and
+  // as a fraction of the input span
+  double linearity_error;
+  double relative_linearity_error;
+  uint64_t levels;
+};
+
+// Steps an output wired straight back to an input through an evenly spaced
+// grid of levels. Every level is held for settle_samples, then the input
+// is averaged over average_samples. When the last level is done, a line is
+// fitted through the averages. Runs on the real-time thread.
+class loopback_calibration
+{
+public:
+  void start(uint64_t level_count,
+             double low,
+             double high,
+             size_t settle_samples,
+             size_t average_samples)
+  {
+    count = level_count < 2 ? 2 : level_count;
+    count = count < MAX_LOOPBACK_LEVELS ? count : MAX_LOOPBACK_LEVELS;
+    for (size_t index = 0; index < count; ++index) {
+      commanded[index] =
+          low + (high - low) * double(index) / double(count - 1);
+    }
+    measured.fill(0.0);
+    // The input read in a period answers the output of the period before
+    settle = settle_samples > 0 ? settle_samples : 1;
+    average = average_samples > 0 ? average_samples : 1;
+    level = 0;
+    phase = 0;
+    running = true;
+  }
+
+  void stop() { running = false; }
+  bool active() const { return running; }
+
+  double output() const { return running ? commanded[level] : 0.0; }
+
+  // Returns true once the last level has been averaged
+  bool push(double sample)
+  {
+    if (!running) {
+      return false;
+    }
+    if (phase >= settle) {
+      measured[level] += sample;
+    }
+    if (++phase < settle + average) {
+      return false;
+    }
+    measured[level] /= double(average);
+    phase = 0;
+    if (++level < count) {
+      return false;
+    }
+    level = count - 1;
+    running = false;
+    return true;
+  }
+
+  loopback_result result() const
+  {
+    loopback_result fit {};
+    fit.levels = count;
+    const line_fit line = fit_line(commanded.data(), measured.data(), count);
+    fit.gain = line.slope;
+    fit.loop_offset = line.intercept;
+    for (size_t index = 0; index < count; ++index) {
+      const double residual =
+          measured[index] - (line.slope * commanded[index] + line.intercept);
+      fit.linearity_error = std::fmax(fit.linearity_error, std::fabs(residual));
+    }
+    const double span = std::fabs(measured[count - 1] - measured[0]);
+    fit.relative_linearity_error = span > 0.0 ? fit.linearity_error / span
+                                              : 0.0;
+    fit.valid = span > 0.0 && std::isfinite(fit.gain);
+    return fit;
+  }
+
+private:
+  std::array<double, MAX_LOOPBACK_LEVELS> commanded {};
+  std::array<double, MAX_LOOPBACK_LEVELS> measured {};
+  size_t count = 2;
+  size_t settle = 0;
+  size_t average = 1;
+  size_t level = 0;
+  size_t phase = 0;
+  bool running = false;
+};
+
+}  // namespace am_amp2400
@@ -0,0 +1,53 @@
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped_file.hpp"
+
+bool am_amp2400::read_file(const std::string& path, void* data, size_t size)
+{
+  const int descriptor = ::open(path.c_str(), O_RDONLY);
+  if (descriptor < 0) {
+    return false;
+  }
+  struct stat info {};
+  if (::fstat(descriptor, &info) != 0
+      || static_cast<size_t>(info.st_size) != size)
+  {
+    ::close(descriptor);
+    return false;
+  }
+  void* mapped =
+      ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+  ::close(descriptor);
+  if (mapped == MAP_FAILED) {
+    return false;
+  }
+  std::memcpy(data, mapped, size);
+  ::munmap(mapped, size);
+  return true;
+}
+
+bool am_amp2400::write_file_atomically(const std::string& path,
+                                       const void* data,
+                                       size_t size)
+{
+  const std::string temporary = path + ".tmp";
+  const int descriptor =
+      ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (descriptor < 0) {
+    return false;
+  }
+  const ssize_t written = ::write(descriptor, data, size);
+  const bool synced = ::fsync(descriptor) == 0;
+  ::close(descriptor);
+  if (written != static_cast<ssize_t>(size) || !synced) {
+    ::unlink(temporary.c_str());
+    return false;
+  }
+  return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+namespace am_amp2400
+{
+
+// Leading fields of every fixed layout file the panel keeps
+struct file_header
+{
+  std::array<char, 8> magic;
+  uint32_t version;
+  uint32_t record_size;
+};
+
+inline bool operator==(const file_header& first, const file_header& second)
+{
+  return first.magic == second.magic && first.version == second.version
+      && first.record_size == second.record_size;
+}
+
+// Maps path and copies size bytes out of it. Fails unless the file is
+// exactly size bytes long.
+bool read_file(const std::string& path, void* data, size_t size);
+
+// Writes size bytes to a temporary file, syncs it and renames it over
+// path, so a crash never leaves a half written file behind.
+bool write_file_atomically(const std::string& path,
+                           const void* data,
+                           size_t size);
+
+// Reads a File that starts with a file_header into contents. Returns false
+// and leaves contents value initialised if the file is missing or its
+// header differs from expected. Otherwise validate(contents) gets to drop
+// whatever it does not trust before the file is used.
+template<class File, class Validate>
+bool load_file(const std::string& path,
+               const file_header& expected,
+               File& contents,
+               Validate validate)
+{
+  static_assert(std::is_trivially_copyable_v<File>,
+                "files are written and mapped byte for byte");
+  if (!read_file(path, &contents, sizeof(File))
+      || !(contents.header == expected))
+  {
+    contents = File {};
+    return false;
+  }
+  validate(contents);
+  return true;
+}
+
+template<class File>
+bool save_file(const std::string& path,
+               const file_header& header,
+               const File& contents)
+{
+  static_assert(std::is_trivially_copyable_v<File>,
+                "files are written and mapped byte for byte");
+  File file = contents;
+  file.header = header;
+  return write_file_atomically(path, &file, sizeof(File));
+}
+
+}  // namespace am_amp2400
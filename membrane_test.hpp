@@ -0,0 +1,206 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "amp_math.hpp"
+
+namespace am_amp2400
+{
+
+// Longest test pulse cycle (pulse plus holding) the engine can average
+constexpr size_t MAX_TEST_PULSE_SAMPLES = 2048;
+
+// Average response to one test pulse cycle. The pulse is on for the first
+// half of the cycle and the amplifier sits at holding for the second half.
+// Current is in A and the amplitude in V, as scaled by the VTest gains.
+struct membrane_trace
+{
+  size_t length;
+  // Sample period in seconds
+  double sample_period;
+  double amplitude;
+  uint64_t sweeps;
+  // Last, so that the samples in use end the part of the trace that holds
+  // data, see used_bytes
+  std::array<double, MAX_TEST_PULSE_SAMPLES> current;
+};
+
+// Leading bytes of a trace that hold data
+inline size_t used_bytes(const membrane_trace& trace)
+{
+  return offsetof(membrane_trace, current) + trace.length * sizeof(double);
+}
+
+// Generates a periodic square pulse and averages the current response of
+// every cycle into a preallocated trace. Runs on the real-time thread.
+class membrane_test
+{
+public:
+  void start(size_t cycle_samples,
+             double amplitude,
+             uint64_t sweeps,
+             double sample_period)
+  {
+    length = cycle_samples < MAX_TEST_PULSE_SAMPLES ? cycle_samples
+                                                    : MAX_TEST_PULSE_SAMPLES;
+    length = length < 2 ? 2 : length;
+    average.length = length;
+    average.sample_period = sample_period;
+    average.amplitude = amplitude;
+    average.sweeps = 0;
+    sweeps_per_average = sweeps > 0 ? sweeps : 1;
+    phase = 0;
+    restart = true;
+    running = true;
+  }
+
+  void stop() { running = false; }
+  bool active() const { return running; }
+
+  // Command for the current sample, relative to holding
+  double output() const
+  {
+    return running && phase < length / 2 ? average.amplitude : 0.0;
+  }
+
+  // Accumulates the response to the current sample. Returns true when an
+  // average is complete, which stays readable until the next push.
+  bool push(double current)
+  {
+    if (!running) {
+      return false;
+    }
+    if (restart) {
+      for (size_t index = 0; index < length; ++index) {
+        average.current[index] = 0.0;
+      }
+      average.sweeps = 0;
+      restart = false;
+    }
+    average.current[phase] += current;
+    if (++phase < length) {
+      return false;
+    }
+    phase = 0;
+    if (++average.sweeps < sweeps_per_average) {
+      return false;
+    }
+    const double scale = 1.0 / double(average.sweeps);
+    for (size_t index = 0; index < length; ++index) {
+      average.current[index] *= scale;
+    }
+    restart = true;
+    return true;
+  }
+
+  const membrane_trace& trace() const { return average; }
+
+private:
+  membrane_trace average {};
+  size_t length = 2;
+  size_t phase = 0;
+  uint64_t sweeps_per_average = 1;
+  bool restart = true;
+  bool running = false;
+};
+
+// Passive parameters in ohms, farads and seconds. Only the seal resistance
+// is available when no capacitive transient could be fitted, e.g. before
+// break-in.
+struct membrane_fit
+{
+  bool seal_valid;
+  bool cell_valid;
+  double seal_resistance;
+  double access_resistance;
+  double membrane_resistance;
+  double membrane_capacitance;
+  double time_constant;
+};
+
+// Fits the averaged response to a voltage step. The steady-state currents
+// at the end of the pulse and of the holding period give the total
+// resistance. The decay of the capacitive transient is fitted with a
+// log-linear least-squares exponential, extrapolated back to the step to
+// get the access resistance, and the rest follows from the RC circuit.
+inline membrane_fit fit_membrane_test(const membrane_trace& trace)
+{
+  membrane_fit fit {};
+  const size_t half = trace.length / 2;
+  if (half < 8 || trace.amplitude == 0.0 || trace.sample_period <= 0.0) {
+    return fit;
+  }
+  // Work on a positive step so the transient always decays from above
+  const double sign = trace.amplitude > 0.0 ? 1.0 : -1.0;
+  const double step = std::fabs(trace.amplitude);
+  const size_t window = half / 5;
+  const double* current = trace.current.data();
+  const double baseline = sign
+      * block_sum(current + trace.length - window, window) / double(window);
+  const double steady =
+      sign * block_sum(current + half - window, window) / double(window);
+  const double delta = steady - baseline;
+  if (delta <= 0.0) {
+    return fit;
+  }
+  fit.seal_resistance = step / delta;
+  fit.seal_valid = true;
+
+  size_t peak = 0;
+  for (size_t index = 1; index < half - window; ++index) {
+    if (sign * current[index] > sign * current[peak]) {
+      peak = index;
+    }
+  }
+  const double peak_excess = sign * current[peak] - steady;
+  if (peak_excess <= 0.0) {
+    return fit;
+  }
+  double count = 0.0;
+  double sum_t = 0.0;
+  double sum_y = 0.0;
+  double sum_tt = 0.0;
+  double sum_ty = 0.0;
+  for (size_t index = peak; index < half - window; ++index) {
+    const double excess = sign * current[index] - steady;
+    if (excess < 0.1 * peak_excess) {
+      break;
+    }
+    const double t = double(index - peak) * trace.sample_period;
+    const double y = std::log(excess);
+    count += 1.0;
+    sum_t += t;
+    sum_y += y;
+    sum_tt += t * t;
+    sum_ty += t * y;
+  }
+  const double denominator = count * sum_tt - sum_t * sum_t;
+  if (count < 3.0 || denominator <= 0.0) {
+    return fit;
+  }
+  const double slope = (count * sum_ty - sum_t * sum_y) / denominator;
+  const double intercept = (sum_y - slope * sum_t) / count;
+  if (slope >= 0.0) {
+    return fit;
+  }
+  // Right after the step the membrane capacitance is a short, so the whole
+  // step falls across the access resistance
+  const double onset = -double(peak) * trace.sample_period;
+  const double onset_current = std::exp(intercept + slope * onset) + delta;
+  fit.time_constant = -1.0 / slope;
+  fit.access_resistance = step / onset_current;
+  fit.membrane_resistance = fit.seal_resistance - fit.access_resistance;
+  if (fit.membrane_resistance <= 0.0) {
+    return fit;
+  }
+  fit.membrane_capacitance = fit.time_constant
+      * (fit.access_resistance + fit.membrane_resistance)
+      / (fit.access_resistance * fit.membrane_resistance);
+  fit.cell_valid = true;
+  return fit;
+}
+
+}  // namespace am_amp2400
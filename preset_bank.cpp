@@ -0,0 +1,59 @@
+#include <algorithm>
+
+#include "preset_bank.hpp"
+
+namespace
+{
+constexpr am_amp2400::file_header PRESET_HEADER = {
+    {'A', 'M', '2', '4', 'P', 'R', 'S', 'T'},
+    1,
+    sizeof(am_amp2400::preset)};
+}  // namespace
+
+bool am_amp2400::preset_bank::load(const std::string& path)
+{
+  return load_file(path,
+                   PRESET_HEADER,
+                   contents,
+                   [](preset_file& file)
+                   {
+                     // Never trust the name terminator or the enums read
+                     // from disk
+                     for (auto& entry : file.presets) {
+                       entry.name.back() = '\0';
+                       if (!valid_mode(entry.config.mode)
+                           || entry.config.probe_gain > HIGH)
+                       {
+                         entry.used = 0;
+                       }
+                     }
+                   });
+}
+
+bool am_amp2400::preset_bank::save(const std::string& path) const
+{
+  return save_file(path, PRESET_HEADER, contents);
+}
+
+void am_amp2400::preset_bank::store(size_t slot,
+                                    const std::string& name,
+                                    const amp_config& config)
+{
+  preset& entry = contents.presets[slot];
+  entry.name = {};
+  std::copy_n(name.begin(),
+              std::min(name.size(), PRESET_NAME_SIZE - 1),
+              entry.name.begin());
+  entry.used = 1;
+  entry.config = config;
+}
+
+void am_amp2400::preset_bank::clear(size_t slot)
+{
+  contents.presets[slot] = preset {};
+}
+
+std::string am_amp2400::preset_bank::name(size_t slot) const
+{
+  return std::string(contents.presets[slot].name.data());
+}
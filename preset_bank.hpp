@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "daq_state.hpp"
+#include "mapped_file.hpp"
+
+namespace am_amp2400
+{
+
+// Number of presets, one per Ctrl+1..9 shortcut
+constexpr size_t NUM_PRESETS = 9;
+constexpr size_t PRESET_NAME_SIZE = 32;
+
+// One stored amplifier configuration. The record is written to disk as is,
+// so it only holds fixed size fields.
+struct preset
+{
+  std::array<char, PRESET_NAME_SIZE> name;
+  uint32_t used;
+  amp_config config;
+};
+
+// On-disk layout of the preset file: a header followed by every preset
+// slot, used or not, so the file always has the same size.
+struct preset_file
+{
+  file_header header;
+  std::array<preset, NUM_PRESETS> presets;
+};
+
+static_assert(std::is_trivially_copyable_v<preset_file>,
+              "presets are written and mapped byte for byte");
+
+// Named amplifier configurations kept in memory and persisted to a fixed
+// layout binary file. The file is only touched on load and store, so
+// recalling a preset is a plain copy.
+class preset_bank
+{
+public:
+  // Maps the file and copies the presets out of it. Returns false and
+  // leaves the bank empty if the file is missing or was written by an
+  // incompatible version.
+  bool load(const std::string& path);
+
+  // Writes the whole bank to a temporary file and renames it over path, so
+  // a crash never leaves a half written file behind.
+  bool save(const std::string& path) const;
+
+  void store(size_t slot, const std::string& name, const amp_config& config);
+  void clear(size_t slot);
+  bool used(size_t slot) const { return contents.presets[slot].used != 0; }
+  std::string name(size_t slot) const;
+  const amp_config& config(size_t slot) const
+  {
+    return contents.presets[slot].config;
+  }
+
+private:
+  preset_file contents {};
+};
+
+}  // namespace am_amp2400
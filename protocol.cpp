@@ -0,0 +1,68 @@
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+
+#include "protocol.hpp"
+
+namespace
+{
+// Reads "500ms" or "2.5s" into seconds
+bool read_duration(std::istringstream& fields, double& seconds)
+{
+  std::string text;
+  if (!(fields >> text)) {
+    return false;
+  }
+  char* unit_start = nullptr;
+  double value = std::strtod(text.c_str(), &unit_start);
+  const std::string unit(unit_start);
+  if (unit == "ms") {
+    value *= 1e-3;
+  } else if (unit != "s") {
+    return false;
+  }
+  seconds = value;
+  return std::isfinite(value) && value > 0;
+}
+}  // namespace
+
+std::string am_amp2400::parse_protocol(
+    std::istream& text,
+    const std::array<amp_config, MAX_AMPLIFIERS>& initial,
+    size_t initial_amp,
+    const command_limits& limits,
+    std::vector<protocol_entry>& out)
+{
+  out.clear();
+  std::array<amp_config, MAX_AMPLIFIERS> amps = initial;
+  std::string line;
+  for (size_t number = 1; std::getline(text, line); ++number) {
+    std::istringstream fields(line.substr(0, line.find('#')));
+    protocol_entry entry {};
+    if (!(fields >> entry.name)) {
+      continue;
+    }
+    const std::string where = "line " + std::to_string(number) + ": ";
+    if (!read_duration(fields, entry.duration)) {
+      return where + "expected a duration such as 500ms or 2s";
+    }
+    if (out.size() == MAX_PROTOCOL_STEPS) {
+      return where + "too many steps";
+    }
+    std::string commands;
+    std::getline(fields, commands);
+    command_batch batch {amps, initial_amp, 0, false, false};
+    const std::string error = run_commands(commands, limits, batch);
+    if (!error.empty()) {
+      return where + error;
+    }
+    amps = batch.amps;
+    entry.amp_mask = batch.touched;
+    entry.amps = amps;
+    out.push_back(std::move(entry));
+  }
+  if (out.empty()) {
+    return "no steps";
+  }
+  return {};
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "amp_commands.hpp"
+#include "daq_state.hpp"
+
+namespace am_amp2400
+{
+
+// Longest protocol a file may describe
+constexpr size_t MAX_PROTOCOL_STEPS = 4096;
+
+// One step of a protocol, with every amplifier configuration resolved
+struct protocol_entry
+{
+  std::string name;
+  // Time until the next step is applied, in seconds
+  double duration;
+  // Bit i is set when the step applies amplifier i
+  uint32_t amp_mask;
+  std::array<amp_config, MAX_AMPLIFIERS> amps;
+};
+
+// Parses a protocol. Every line that is not blank or a '#' comment is a step
+//
+//   NAME DURATION COMMANDS
+//
+// e.g. "seal 5s mode vtest". DURATION is a number followed by "ms" or "s".
+// COMMANDS are those of run_commands and start from the configuration left
+// by the previous step (initial for the first one), on initial_amp unless
+// they pick another. A step applies every amplifier its commands touched;
+// a step without commands only waits. Returns an empty string on success,
+// otherwise "line N: reason".
+std::string parse_protocol(
+    std::istream& text,
+    const std::array<amp_config, MAX_AMPLIFIERS>& initial,
+    size_t initial_amp,
+    const command_limits& limits,
+    std::vector<protocol_entry>& out);
+
+}  // namespace am_amp2400
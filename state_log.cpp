@@ -0,0 +1,153 @@
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "state_log.hpp"
+
+namespace
+{
+constexpr std::array<char, 8> STATE_LOG_MAGIC = {
+    'A', 'M', '2', '4', 'S', 'L', 'O', 'G'};
+constexpr uint32_t STATE_LOG_VERSION = 1;
+
+size_t log_size(uint64_t capacity)
+{
+  return sizeof(am_amp2400::state_log::file_header)
+      + capacity * sizeof(am_amp2400::state_log::slot);
+}
+
+bool compatible(const am_amp2400::state_log::file_header& header,
+                size_t file_size)
+{
+  return header.magic == STATE_LOG_MAGIC && header.version == STATE_LOG_VERSION
+      && header.slot_size == sizeof(am_amp2400::state_log::slot)
+      && header.capacity > 0 && log_size(header.capacity) == file_size;
+}
+}  // namespace
+
+bool am_amp2400::state_log::open(const std::string& path, uint64_t capacity)
+{
+  close();
+  const int descriptor = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (descriptor < 0) {
+    return false;
+  }
+  struct stat info {};
+  if (::fstat(descriptor, &info) != 0) {
+    ::close(descriptor);
+    return false;
+  }
+  auto file_size = static_cast<size_t>(info.st_size);
+  bool reuse = false;
+  if (file_size >= sizeof(file_header)) {
+    file_header existing {};
+    reuse = ::pread(descriptor, &existing, sizeof(file_header), 0)
+            == static_cast<ssize_t>(sizeof(file_header))
+        && compatible(existing, file_size);
+  }
+  if (!reuse) {
+    file_size = log_size(capacity);
+    if (::ftruncate(descriptor, 0) != 0
+        || ::ftruncate(descriptor, static_cast<off_t>(file_size)) != 0)
+    {
+      ::close(descriptor);
+      return false;
+    }
+  }
+  // Populate the mapping up front so appending never page faults on the
+  // real-time thread
+  void* mapped = ::mmap(nullptr,
+                        file_size,
+                        PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE,
+                        descriptor,
+                        0);
+  ::close(descriptor);
+  if (mapped == MAP_FAILED) {
+    return false;
+  }
+  header = static_cast<file_header*>(mapped);
+  if (!reuse) {
+    new (header) file_header {STATE_LOG_MAGIC,
+                              STATE_LOG_VERSION,
+                              sizeof(slot),
+                              capacity,
+                              {0}};
+  }
+  entries = reinterpret_cast<slot*>(header + 1);
+  mapped_size = file_size;
+  return true;
+}
+
+void am_amp2400::state_log::close()
+{
+  if (header != nullptr) {
+    ::munmap(header, mapped_size);
+  }
+  header = nullptr;
+  entries = nullptr;
+  mapped_size = 0;
+}
+
+void am_amp2400::state_log::append(const state_entry& entry)
+{
+  if (header == nullptr) {
+    return;
+  }
+  const uint64_t index = header->next.fetch_add(1, std::memory_order_relaxed);
+  slot& target = entries[index % header->capacity];
+  target.sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  target.entry = entry;
+  target.sequence.store(index + 1, std::memory_order_release);
+}
+
+bool am_amp2400::state_log::read(const std::string& path,
+                                 std::vector<state_entry>& out)
+{
+  const int descriptor = ::open(path.c_str(), O_RDONLY);
+  if (descriptor < 0) {
+    return false;
+  }
+  struct stat info {};
+  if (::fstat(descriptor, &info) != 0
+      || static_cast<size_t>(info.st_size) < sizeof(file_header))
+  {
+    ::close(descriptor);
+    return false;
+  }
+  const auto file_size = static_cast<size_t>(info.st_size);
+  void* mapped =
+      ::mmap(nullptr, file_size, PROT_READ, MAP_SHARED, descriptor, 0);
+  ::close(descriptor);
+  if (mapped == MAP_FAILED) {
+    return false;
+  }
+  const auto* file = static_cast<const file_header*>(mapped);
+  if (!compatible(*file, file_size)) {
+    ::munmap(mapped, file_size);
+    return false;
+  }
+  const auto* ring = reinterpret_cast<const slot*>(file + 1);
+  const uint64_t end = file->next.load(std::memory_order_acquire);
+  const uint64_t begin = end > file->capacity ? end - file->capacity : 0;
+  out.clear();
+  out.reserve(static_cast<size_t>(end - begin));
+  for (uint64_t index = begin; index < end; ++index) {
+    const slot& source = ring[index % file->capacity];
+    const uint64_t before = source.sequence.load(std::memory_order_acquire);
+    const state_entry copy = source.entry;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // Skip entries still being written or already overwritten
+    if (before == index + 1
+        && source.sequence.load(std::memory_order_relaxed) == before)
+    {
+      out.push_back(copy);
+    }
+  }
+  ::munmap(mapped, file_size);
+  return true;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace am_amp2400
+{
+
+// Entries kept before the oldest ones are overwritten (about 7 MB)
+constexpr uint64_t STATE_LOG_CAPACITY = 65536;
+
+// What caused a state to be applied
+enum class state_source : uint32_t
+{
+  SET_DAQ = 0,
+  SCHEDULED,
+  DRIFT_CORRECTION,
+  PANEL,
+  PROTOCOL,
+  WATCHDOG,
+  CALIBRATION,
+  AUTO_RANGE
+};
+
+// One amplifier configuration as handed to the DAQ
+struct state_entry
+{
+  // RT::OS::getTime() of the apply, in ns
+  int64_t time;
+  uint32_t amp;
+  int32_t mode;
+  state_source source;
+  uint32_t ai_range;
+  double probe_gain_factor;
+  double ai_gain;
+  double ai_offset;
+  double ao_gain;
+  double ao_offset;
+  std::array<double, 3> telegraph;
+};
+
+// Append-only ring of state entries in a memory-mapped file. Appending
+// claims a slot with one atomic increment and never allocates or locks, so
+// the real-time thread and the panel can both log. The mapping is shared
+// with the file, so the entries survive a crash of RTXI.
+class state_log
+{
+public:
+  state_log() = default;
+  state_log(const state_log&) = delete;
+  state_log(state_log&&) = delete;
+  state_log& operator=(const state_log&) = delete;
+  state_log& operator=(state_log&&) = delete;
+  ~state_log() { close(); }
+
+  // Maps an existing log and keeps appending to it, or creates a new one
+  // if the file is missing or has another layout.
+  bool open(const std::string& path, uint64_t capacity = STATE_LOG_CAPACITY);
+  void close();
+  bool is_open() const { return header != nullptr; }
+
+  void append(const state_entry& entry);
+
+  // Copies every complete entry still in the log at path, oldest first
+  static bool read(const std::string& path, std::vector<state_entry>& out);
+
+  struct slot;
+  struct file_header;
+
+private:
+  file_header* header = nullptr;
+  slot* entries = nullptr;
+  size_t mapped_size = 0;
+};
+
+// Sequence is the entry index plus one once the entry is complete and zero
+// while it is being written.
+struct state_log::slot
+{
+  std::atomic<uint64_t> sequence;
+  state_entry entry;
+};
+
+struct state_log::file_header
+{
+  std::array<char, 8> magic;
+  uint32_t version;
+  uint32_t slot_size;
+  uint64_t capacity;
+  // Number of entries ever claimed
+  std::atomic<uint64_t> next;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "the log is shared through a file mapping");
+
+}  // namespace am_amp2400
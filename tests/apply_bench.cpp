@@ -0,0 +1,168 @@
+// Mode switches through daq_shadow::apply on the mock device: checks which
+// calls reach the device and times the switch into each mode.
+//
+//   am-amp2400-apply-bench [iterations]
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "../daq_state.hpp"
+#include "bench_util.hpp"
+#include "mock_device.hpp"
+
+namespace
+{
+using am_amp2400::amp_mode;
+using am_amp2400::amp_profile;
+using am_amp2400::apply_stats;
+using am_amp2400::daq_shadow;
+using am_amp2400::daq_state;
+using am_amp2400::NUM_AMP_MODES;
+using am_amp2400::bench::check;
+using am_amp2400::testing::device_call_t;
+using am_amp2400::testing::mock_device;
+
+constexpr std::array<const char*, NUM_AMP_MODES> MODE_NAMES = {
+    "VClamp", "I=0", "IClamp", "VComp", "VTest", "IResist", "IFollow"};
+
+constexpr am_amp2400::channel_map CHANNELS = {1, 0, {0, 1, 2}};
+
+daq_state state_for(size_t mode)
+{
+  return am_amp2400::make_daq_state<amp_profile>(
+      static_cast<amp_mode>(mode),
+      amp_profile::probe_gain_factors[0],
+      CHANNELS,
+      0.001,
+      -0.002);
+}
+
+// Calls a switch between two states on the same channels has to make
+uint64_t expected_calls(const daq_state& from, const daq_state& to)
+{
+  uint64_t calls = 0;
+  calls += from.ai_range != to.ai_range ? 1 : 0;
+  calls += from.ai_gain != to.ai_gain ? 1 : 0;
+  calls += from.ai_offset != to.ai_offset ? 1 : 0;
+  calls += from.ao_gain != to.ao_gain ? 1 : 0;
+  calls += from.ao_offset != to.ao_offset ? 1 : 0;
+  for (size_t bit = 0; bit < to.telegraph.size(); ++bit) {
+    calls += from.telegraph[bit] != to.telegraph[bit] ? 1 : 0;
+  }
+  return calls;
+}
+
+bool holds(const mock_device& device, const daq_state& state)
+{
+  bool lines_match = true;
+  for (size_t bit = 0; bit < state.telegraph.size(); ++bit) {
+    lines_match &=
+        device.line(state.telegraph_lines[bit]) == state.telegraph[bit];
+  }
+  return lines_match && am_amp2400::find_mismatches(device, state) == 0;
+}
+
+bool check_calls()
+{
+  bool passed = true;
+  for (size_t mode = 0; mode < NUM_AMP_MODES; ++mode) {
+    mock_device device;
+    daq_shadow shadow;
+    apply_stats stats {};
+    const daq_state target = state_for(mode);
+
+    // A shadow that knows nothing writes everything, in a fixed order
+    shadow.apply(device, target, stats);
+    passed &= check(stats.issued == 8 && stats.skipped == 0, "cold apply");
+    passed &= check(holds(device, target), "cold apply state");
+    const std::array<device_call_t, 8> order = {device_call_t::SET_RANGE,
+                                                device_call_t::SET_GAIN,
+                                                device_call_t::SET_ZERO_OFFSET,
+                                                device_call_t::SET_GAIN,
+                                                device_call_t::SET_ZERO_OFFSET,
+                                                device_call_t::WRITE,
+                                                device_call_t::WRITE,
+                                                device_call_t::WRITE};
+    bool in_order = device.log().size() == order.size();
+    for (size_t index = 0; in_order && index < order.size(); ++index) {
+      in_order = device.log()[index].type == order[index];
+    }
+    passed &= check(in_order, "cold apply call order");
+
+    // Applying the same state again must not reach the device
+    device.clear_log();
+    stats = {};
+    shadow.apply(device, target, stats);
+    passed &= check(stats.issued == 0 && device.log().empty(), "re-apply");
+
+    // Switching only writes what differs
+    for (size_t next = 0; next < NUM_AMP_MODES; ++next) {
+      const daq_state from = shadow.state();
+      const daq_state to = state_for(next);
+      device.clear_log();
+      stats = {};
+      shadow.apply(device, to, stats);
+      passed &= check(stats.issued == expected_calls(from, to)
+                          && device.log().size() == stats.issued,
+                      "switch call count");
+      passed &= check(holds(device, to), "switch state");
+    }
+  }
+  return passed;
+}
+
+// Switches into each mode from every mode in turn
+void time_switches(size_t iterations)
+{
+  std::printf(
+      "%-10s %12s %12s %14s %14s\n",
+      "to mode",
+      "switch (ns)",
+      "cold (ns)",
+      "calls/switch",
+      "skipped/switch");
+  for (size_t mode = 0; mode < NUM_AMP_MODES; ++mode) {
+    mock_device device;
+    daq_shadow shadow;
+    apply_stats stats {};
+    const daq_state target = state_for(mode);
+    std::array<daq_state, NUM_AMP_MODES> sources {};
+    for (size_t source = 0; source < NUM_AMP_MODES; ++source) {
+      sources[source] = state_for(source);
+    }
+
+    std::chrono::nanoseconds switching {};
+    std::chrono::nanoseconds cold {};
+    for (size_t index = 0; index < iterations; ++index) {
+      apply_stats ignored {};
+      shadow.apply(device, sources[index % NUM_AMP_MODES], ignored);
+      auto start = std::chrono::steady_clock::now();
+      shadow.apply(device, target, stats);
+      switching += std::chrono::steady_clock::now() - start;
+
+      shadow.invalidate();
+      start = std::chrono::steady_clock::now();
+      shadow.apply(device, target, ignored);
+      cold += std::chrono::steady_clock::now() - start;
+      device.clear_log();
+    }
+    std::printf("%-10s %12.1f %12.1f %14.2f %14.2f\n",
+                MODE_NAMES[mode],
+                double(switching.count()) / double(iterations),
+                double(cold.count()) / double(iterations),
+                double(stats.issued) / double(iterations),
+                double(stats.skipped) / double(iterations));
+  }
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  const size_t iterations =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+  const bool passed = check_calls();
+  time_switches(iterations > 0 ? iterations : 1);
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
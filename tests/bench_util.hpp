@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+
+namespace am_amp2400::bench
+{
+
+// Makes the optimiser assume the value is used (GCC and Clang)
+template<class T>
+inline void keep(const T& value)
+{
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Mean wall time of one call in ns over iterations calls
+template<class Call>
+double ns_per_call(size_t iterations, const Call& call)
+{
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t index = 0; index < iterations; ++index) {
+    call(index);
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  return double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                    .count())
+      / double(iterations);
+}
+
+// Failed checks make the test fail, but every check still runs
+inline bool check(bool condition, const char* what)
+{
+  if (!condition) {
+    std::fprintf(stderr, "FAILED: %s\n", what);
+  }
+  return condition;
+}
+
+}  // namespace am_amp2400::bench
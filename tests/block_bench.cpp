@@ -0,0 +1,96 @@
+// Block kernels run on the real-time thread: checks block_max_abs against
+// a plain loop and times both on an auto-ranging block.
+//
+//   am-amp2400-block-bench [iterations]
+
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+
+#include "../amp_math.hpp"
+#include "../auto_range.hpp"
+#include "bench_util.hpp"
+
+namespace
+{
+double naive_max_abs(const double* values, size_t count)
+{
+  double peak = 0.0;
+  for (size_t index = 0; index < count; ++index) {
+    if (std::fabs(values[index]) > peak) {
+      peak = std::fabs(values[index]);
+    }
+  }
+  return peak;
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  using am_amp2400::block_max_abs;
+  using am_amp2400::bench::check;
+  using am_amp2400::bench::keep;
+  using am_amp2400::bench::ns_per_call;
+
+  const size_t iterations =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+  bool passed = true;
+
+  // Every length and alignment around the vector width, with the peak on
+  // every position and of either sign
+  std::array<double, 80> values {};
+  std::mt19937 generator(2400);
+  std::uniform_real_distribution<double> sample(-1.0, 1.0);
+  bool matches = true;
+  for (size_t start = 0; start < 3; ++start) {
+    for (size_t count = 0; start + count <= values.size(); ++count) {
+      for (size_t peak = 0; peak < count; ++peak) {
+        for (auto& value : values) {
+          value = sample(generator);
+        }
+        values[start + peak] = peak % 2 == 0 ? 7.5 : -7.5;
+        matches &= block_max_abs(values.data() + start, count)
+            == naive_max_abs(values.data() + start, count);
+      }
+      matches &= count > 0 || block_max_abs(values.data() + start, 0) == 0.0;
+    }
+  }
+  passed &= check(matches, "block_max_abs matches a plain loop");
+
+  // A NaN sample is skipped the same way by every path
+  for (auto& value : values) {
+    value = 0.25;
+  }
+  values[1] = std::numeric_limits<double>::quiet_NaN();
+  values[6] = std::numeric_limits<double>::quiet_NaN();
+  values[values.size() - 1] = std::numeric_limits<double>::quiet_NaN();
+  passed &= check(block_max_abs(values.data(), values.size()) == 0.25,
+                  "block_max_abs skips NaN");
+
+  std::array<double, am_amp2400::AUTO_RANGE_BLOCK_SIZE> block {};
+  for (auto& value : block) {
+    value = sample(generator);
+  }
+  const double vector_ns = ns_per_call(
+      iterations,
+      [&](size_t)
+      {
+        keep(block);
+        keep(block_max_abs(block.data(), block.size()));
+      });
+  const double plain_ns = ns_per_call(
+      iterations,
+      [&](size_t)
+      {
+        keep(block);
+        keep(naive_max_abs(block.data(), block.size()));
+      });
+  std::printf("max abs of %zu samples: block_max_abs %.2f ns, plain %.2f ns\n",
+              block.size(),
+              vector_ns,
+              plain_ns);
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+// Headless stand-in for the parts of RTXI's DAQ header that the plugin's
+// device-independent headers use. Only the tests build against it.
+
+#include <cstddef>
+
+namespace DAQ
+{
+
+enum ChannelType : size_t
+{
+  AI = 0,
+  AO,
+  DI,
+  DO,
+  UNKNOWN_CHANNEL
+};
+
+using index_t = size_t;
+
+}  // namespace DAQ
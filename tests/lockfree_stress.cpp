@@ -0,0 +1,169 @@
+// Hammers the command ring and the seqlock from a GUI-side thread while a
+// consumer drains them once per simulated real-time period. Every item and
+// snapshot carries its sequence number in all of its words, so a lost,
+// reordered or torn copy is detected.
+//
+//   am-amp2400-lockfree-stress [seconds] [period_us]
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "../lockfree.hpp"
+#include "bench_util.hpp"
+
+namespace
+{
+using am_amp2400::bench::check;
+
+// About the size of a small command. The seqlock gets a larger value so
+// that a copy spans several cache lines.
+struct stamped_item
+{
+  std::array<uint64_t, 16> words;
+};
+
+struct stamped_snapshot
+{
+  std::array<uint64_t, 96> words;
+};
+
+template<class T>
+T stamp(uint64_t sequence)
+{
+  T value {};
+  value.words.fill(sequence);
+  return value;
+}
+
+template<class T>
+bool intact(const T& value)
+{
+  for (const uint64_t word : value.words) {
+    if (word != value.words[0]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+struct consumer_result
+{
+  uint64_t items = 0;
+  uint64_t snapshots = 0;
+  uint64_t periods = 0;
+  bool ordered = true;
+  bool items_intact = true;
+  bool snapshots_intact = true;
+  bool snapshots_monotonic = true;
+  // Longest time spent draining in one period
+  std::chrono::nanoseconds worst_drain {};
+};
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  const double seconds = argc > 1 ? std::strtod(argv[1], nullptr) : 2.0;
+  const auto period =
+      std::chrono::microseconds(argc > 2 ? std::atoi(argv[2]) : 20);
+
+  am_amp2400::spsc_ring<stamped_item, 64> ring;
+  am_amp2400::seqlock<stamped_snapshot> snapshots;
+  std::atomic<bool> producing = true;
+  std::atomic<bool> consuming = true;
+  std::atomic<uint64_t> pushed = 0;
+  std::atomic<uint64_t> published = 0;
+  std::atomic<uint64_t> full = 0;
+
+  // Real-time side: wakes once per period and drains whatever is there
+  consumer_result result;
+  std::thread consumer(
+      [&]()
+      {
+        uint64_t expected = 0;
+        uint64_t version = 0;
+        uint64_t last_snapshot = 0;
+        auto wake = std::chrono::steady_clock::now();
+        while (consuming.load(std::memory_order_relaxed)) {
+          wake += period;
+          std::this_thread::sleep_until(wake);
+          const auto start = std::chrono::steady_clock::now();
+          stamped_item item {};
+          while (ring.try_pop(item)) {
+            result.items_intact &= intact(item);
+            result.ordered &= item.words[0] == expected;
+            expected = item.words[0] + 1;
+            ++result.items;
+          }
+          stamped_snapshot snapshot {};
+          if (snapshots.read_if_newer(snapshot, version)) {
+            result.snapshots_intact &= intact(snapshot);
+            result.snapshots_monotonic &= snapshot.words[0] > last_snapshot;
+            last_snapshot = snapshot.words[0];
+            ++result.snapshots;
+          }
+          const auto drain = std::chrono::steady_clock::now() - start;
+          result.worst_drain = std::max(
+              result.worst_drain,
+              std::chrono::duration_cast<std::chrono::nanoseconds>(drain));
+          ++result.periods;
+        }
+        // Whatever the producer pushed before it stopped
+        stamped_item item {};
+        while (ring.try_pop(item)) {
+          result.items_intact &= intact(item);
+          result.ordered &= item.words[0] == expected;
+          expected = item.words[0] + 1;
+          ++result.items;
+        }
+      });
+
+  // GUI side: pushes and publishes as fast as it can
+  std::thread producer(
+      [&]()
+      {
+        uint64_t sequence = 0;
+        uint64_t snapshot = 0;
+        while (producing.load(std::memory_order_relaxed)) {
+          if (ring.try_push(stamp<stamped_item>(sequence))) {
+            ++sequence;
+          } else {
+            full.fetch_add(1, std::memory_order_relaxed);
+          }
+          snapshots.publish(stamp<stamped_snapshot>(++snapshot));
+        }
+        pushed = sequence;
+        published = snapshot;
+      });
+
+  std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+  producing = false;
+  producer.join();
+  consuming = false;
+  consumer.join();
+
+  std::printf(
+      "periods %llu, items %llu of %llu pushed (ring full %llu times), "
+      "snapshots read %llu of %llu published, worst drain %.1f us\n",
+      static_cast<unsigned long long>(result.periods),
+      static_cast<unsigned long long>(result.items),
+      static_cast<unsigned long long>(pushed.load()),
+      static_cast<unsigned long long>(full.load()),
+      static_cast<unsigned long long>(result.snapshots),
+      static_cast<unsigned long long>(published.load()),
+      double(result.worst_drain.count()) * 1e-3);
+
+  bool passed = true;
+  passed &= check(result.items == pushed.load(), "every item arrived");
+  passed &= check(result.ordered, "items arrived in order");
+  passed &= check(result.items_intact, "items arrived whole");
+  passed &= check(result.snapshots > 0, "snapshots were read");
+  passed &= check(result.snapshots_intact, "snapshots were not torn");
+  passed &= check(result.snapshots_monotonic, "snapshots never went back");
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,113 @@
+// Membrane test engine: checks that cycles are averaged the requested
+// number of times, and times the per-sample cost of the real-time side.
+//
+//   am-amp2400-membrane-bench [iterations]
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "../lockfree.hpp"
+#include "../membrane_test.hpp"
+#include "bench_util.hpp"
+
+namespace
+{
+using am_amp2400::membrane_test;
+
+// Sample of cycle number sweep at phase, distinct for every pair
+double sample_at(uint64_t sweep, size_t phase)
+{
+  return double(sweep) * 1000.0 + double(phase);
+}
+
+bool check_average(size_t cycle_samples, uint64_t sweeps)
+{
+  using am_amp2400::bench::check;
+
+  membrane_test test;
+  test.start(cycle_samples, 0.01, sweeps, 1e-4);
+  bool passed = true;
+  // Two whole averages in a row, so the restart is covered as well
+  for (uint64_t average = 0; average < 2; ++average) {
+    bool early = false;
+    bool completed = false;
+    for (uint64_t sweep = 0; sweep < sweeps; ++sweep) {
+      for (size_t phase = 0; phase < cycle_samples; ++phase) {
+        const bool done = test.push(sample_at(sweep, phase));
+        const bool last = sweep + 1 == sweeps && phase + 1 == cycle_samples;
+        early |= done && !last;
+        completed |= done && last;
+      }
+    }
+    passed &= check(!early, "no average before the last sweep");
+    passed &= check(completed, "average after the last sweep");
+
+    const auto& trace = test.trace();
+    passed &= check(trace.sweeps == sweeps, "sweeps in the average");
+    bool mean = trace.length == cycle_samples;
+    for (size_t phase = 0; mean && phase < cycle_samples; ++phase) {
+      // Mean of sweep * 1000 + phase over sweeps 0 .. sweeps - 1
+      const double expected = double(sweeps - 1) * 500.0 + double(phase);
+      mean = std::fabs(trace.current[phase] - expected) < 1e-9 * expected
+          + 1e-12;
+    }
+    passed &= check(mean, "trace is the mean of the sweeps");
+  }
+  return passed;
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  using am_amp2400::bench::keep;
+  using am_amp2400::bench::ns_per_call;
+
+  const size_t iterations =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+  bool passed = true;
+  for (const uint64_t sweeps : {1, 2, 7, 50}) {
+    for (const size_t cycle_samples : {16, 100, 2048}) {
+      passed &= check_average(cycle_samples, sweeps);
+    }
+  }
+
+  membrane_test test;
+  test.start(100, 0.01, 20, 1e-4);
+  const double push_ns = ns_per_call(
+      iterations,
+      [&](size_t call)
+      {
+        keep(test.push(double(call & 255)));
+        keep(test.output());
+      });
+  std::printf("membrane test: %.2f ns per sample\n", push_ns);
+
+  // A finished average is published with only the samples in use
+  membrane_test shortest;
+  shortest.start(16, 0.01, 1, 1e-4);
+  for (size_t phase = 0; phase < 16; ++phase) {
+    shortest.push(sample_at(0, phase));
+  }
+  const auto& trace = shortest.trace();
+  static am_amp2400::seqlock<am_amp2400::membrane_trace> traces;
+  static am_amp2400::membrane_trace copy {};
+  uint64_t version = 0;
+  traces.publish(trace, am_amp2400::used_bytes(trace));
+  bool same = traces.read_if_newer(copy, version) && copy.length == 16
+      && copy.sweeps == 1 && copy.amplitude == trace.amplitude;
+  for (size_t phase = 0; same && phase < 16; ++phase) {
+    same = copy.current[phase] == trace.current[phase];
+  }
+  passed &= am_amp2400::bench::check(same, "published trace");
+  const double used_ns = ns_per_call(
+      iterations,
+      [&](size_t)
+      { traces.publish(trace, am_amp2400::used_bytes(trace)); });
+  const double full_ns =
+      ns_per_call(iterations, [&](size_t) { traces.publish(trace); });
+  std::printf("publish a 16 sample trace: %.2f ns, whole buffer %.2f ns\n",
+              used_ns,
+              full_ns);
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
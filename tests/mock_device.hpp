@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <rtxi/daq.hpp>
+
+namespace am_amp2400::testing
+{
+
+enum class device_call_t : uint8_t
+{
+  SET_RANGE = 0,
+  SET_GAIN,
+  SET_ZERO_OFFSET,
+  WRITE
+};
+
+struct device_call
+{
+  device_call_t type;
+  DAQ::ChannelType channel_type;
+  // Channel, or digital line for WRITE
+  size_t index;
+  double value;
+  // steady_clock time of the call in ns
+  int64_t time;
+};
+
+// In-memory stand-in for DAQ::Device with the calls daq_shadow::apply and
+// find_mismatches use. Every setter and writeinput call is recorded with a
+// timestamp, and the settings written can be read back like those of a
+// board. The log is preallocated so that recording does not allocate
+// inside a timed region.
+class mock_device
+{
+public:
+  static constexpr size_t CHANNELS = 32;
+
+  explicit mock_device(size_t log_capacity = 1U << 20)
+  {
+    calls.reserve(log_capacity);
+  }
+
+  int setAnalogRange(DAQ::ChannelType type, size_t index, size_t range)
+  {
+    record(device_call_t::SET_RANGE, type, index, double(range));
+    analog(type, index).range = range;
+    return 0;
+  }
+
+  int setAnalogGain(DAQ::ChannelType type, size_t index, double gain)
+  {
+    record(device_call_t::SET_GAIN, type, index, gain);
+    analog(type, index).gain = gain;
+    return 0;
+  }
+
+  int setAnalogZeroOffset(DAQ::ChannelType type, size_t index, double offset)
+  {
+    record(device_call_t::SET_ZERO_OFFSET, type, index, offset);
+    analog(type, index).offset = offset;
+    return 0;
+  }
+
+  void writeinput(size_t line, double value)
+  {
+    record(device_call_t::WRITE, DAQ::ChannelType::DO, line, value);
+    lines.at(line) = value;
+  }
+
+  size_t getAnalogRange(DAQ::ChannelType type, size_t index) const
+  {
+    return analog(type, index).range;
+  }
+
+  double getAnalogGain(DAQ::ChannelType type, size_t index) const
+  {
+    return analog(type, index).gain;
+  }
+
+  double getAnalogZeroOffset(DAQ::ChannelType type, size_t index) const
+  {
+    return analog(type, index).offset;
+  }
+
+  double line(size_t index) const { return lines.at(index); }
+
+  const std::vector<device_call>& log() const { return calls; }
+  void clear_log() { calls.clear(); }
+
+  size_t count(device_call_t type) const
+  {
+    size_t total = 0;
+    for (const auto& call : calls) {
+      total += call.type == type ? 1 : 0;
+    }
+    return total;
+  }
+
+private:
+  struct channel_settings
+  {
+    size_t range;
+    double gain;
+    double offset;
+  };
+
+  channel_settings& analog(DAQ::ChannelType type, size_t index)
+  {
+    return (type == DAQ::ChannelType::AI ? inputs : outputs).at(index);
+  }
+
+  const channel_settings& analog(DAQ::ChannelType type, size_t index) const
+  {
+    return (type == DAQ::ChannelType::AI ? inputs : outputs).at(index);
+  }
+
+  void record(device_call_t type,
+              DAQ::ChannelType channel_type,
+              size_t index,
+              double value)
+  {
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    calls.push_back(
+        {type,
+         channel_type,
+         index,
+         value,
+         std::chrono::duration_cast<std::chrono::nanoseconds>(now).count()});
+  }
+
+  std::array<channel_settings, CHANNELS> inputs {};
+  std::array<channel_settings, CHANNELS> outputs {};
+  std::array<double, CHANNELS> lines {};
+  std::vector<device_call> calls;
+};
+
+}  // namespace am_amp2400::testing
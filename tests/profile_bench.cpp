@@ -0,0 +1,135 @@
+// Cost of resolving a mode into DAQ settings: the per-mode switch the panel
+// used to carry against the lookup in the constexpr profile table.
+//
+//   am-amp2400-profile-bench [iterations]
+
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "../amp_profile.hpp"
+#include "bench_util.hpp"
+
+namespace
+{
+using am_amp2400::amp_mode;
+using am_amp2400::amp_profile;
+using am_amp2400::resolved_settings;
+using am_amp2400::TELEGRAPH_HIGH;
+using am_amp2400::TELEGRAPH_LOW;
+
+// The switch from the legacy Panel::updateDAQ, with the device calls
+// replaced by the values they were given
+resolved_settings legacy_switch(amp_mode mode, double probe_gain_factor)
+{
+  constexpr double LO = TELEGRAPH_LOW;
+  constexpr double HI = TELEGRAPH_HIGH;
+  switch (mode) {
+    case amp_mode::VCLAMP:
+      return {0,
+              amp_profile::vclamp_ai_gain,
+              amp_profile::vclamp_ao_gain,
+              {LO, HI, LO}};
+    case amp_mode::IEQ0:
+      return {3,
+              amp_profile::izero_ai_gain,
+              amp_profile::izero_ao_gain * probe_gain_factor,
+              {HI, HI, LO}};
+    case amp_mode::ICLAMP:
+      return {3,
+              amp_profile::iclamp_ai_gain,
+              amp_profile::iclamp_ao_gain,
+              {LO, LO, HI}};
+    case amp_mode::VCOMP:
+      return {0,
+              amp_profile::vclamp_ai_gain,
+              amp_profile::vclamp_ao_gain,
+              {HI, LO, LO}};
+    case amp_mode::VTEST:
+      return {0,
+              amp_profile::vclamp_ai_gain,
+              amp_profile::vclamp_ao_gain,
+              {LO, LO, LO}};
+    case amp_mode::IRESIST:
+      return {3,
+              amp_profile::iclamp_ai_gain,
+              amp_profile::iclamp_ao_gain * probe_gain_factor,
+              {HI, LO, HI}};
+    case amp_mode::IFOLLOW:
+      return {3,
+              amp_profile::iclamp_ai_gain * probe_gain_factor,
+              amp_profile::iclamp_ao_gain,
+              {LO, HI, HI}};
+    default:
+      return {};
+  }
+}
+
+bool same(const resolved_settings& first, const resolved_settings& second)
+{
+  return first.ai_range == second.ai_range
+      && first.ai_gain == second.ai_gain && first.ao_gain == second.ao_gain
+      && first.telegraph == second.telegraph;
+}
+
+constexpr std::array<const char*, am_amp2400::NUM_AMP_MODES> MODE_NAMES = {
+    "VClamp", "I=0", "IClamp", "VComp", "VTest", "IResist", "IFollow"};
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  using am_amp2400::bench::check;
+  using am_amp2400::bench::keep;
+  using am_amp2400::bench::ns_per_call;
+
+  const size_t iterations =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+  bool passed = true;
+
+  // Both must describe every mode the same way at both probe gains
+  for (size_t index = 0; index < am_amp2400::NUM_AMP_MODES; ++index) {
+    const auto mode = static_cast<amp_mode>(index);
+    for (const double factor : amp_profile::probe_gain_factors) {
+      passed &= check(same(legacy_switch(mode, factor),
+                           am_amp2400::resolve_mode<amp_profile>(mode, factor)),
+                      MODE_NAMES[index]);
+    }
+  }
+
+  // A random sequence defeats the branch predictor the way a protocol
+  // switching modes would; a fixed mode is the best case for the switch
+  std::vector<amp_mode> sequence(4096);
+  std::mt19937 generator(2400);
+  std::uniform_int_distribution<int> pick(0, am_amp2400::NUM_AMP_MODES - 1);
+  for (auto& mode : sequence) {
+    mode = static_cast<amp_mode>(pick(generator));
+  }
+  const size_t mask = sequence.size() - 1;
+  volatile double probe_gain_factor = amp_profile::probe_gain_factors[0];
+
+  std::printf("%-10s %14s %14s\n", "mode", "switch (ns)", "table (ns)");
+  for (size_t index = 0; index <= am_amp2400::NUM_AMP_MODES; ++index) {
+    const bool mixed = index == am_amp2400::NUM_AMP_MODES;
+    const auto mode_at = [&](size_t call)
+    { return mixed ? sequence[call & mask] : static_cast<amp_mode>(index); };
+    const double before = ns_per_call(
+        iterations,
+        [&](size_t call)
+        { keep(legacy_switch(mode_at(call), probe_gain_factor).ao_gain); });
+    const double after = ns_per_call(
+        iterations,
+        [&](size_t call)
+        {
+          keep(am_amp2400::resolve_mode<amp_profile>(mode_at(call),
+                                                     probe_gain_factor)
+                   .ao_gain);
+        });
+    std::printf("%-10s %14.2f %14.2f\n",
+                mixed ? "mixed" : MODE_NAMES[index],
+                before,
+                after);
+  }
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
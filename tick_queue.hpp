@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace am_amp2400
+{
+
+// Fixed capacity queue of items ordered by the real-time tick they are due
+// on. Items due on the same tick come out in insertion order. Entries are
+// kept sorted with the earliest at the back, so checking and popping the
+// next due item is O(1) and nothing is ever allocated.
+template<class T, size_t Capacity>
+class tick_queue
+{
+public:
+  struct entry
+  {
+    uint64_t tick;
+    T item;
+  };
+
+  // Returns false when the queue is full
+  bool push(uint64_t tick, const T& item)
+  {
+    if (count == Capacity) {
+      return false;
+    }
+    size_t position = 0;
+    while (position < count && entries[position].tick > tick) {
+      ++position;
+    }
+    for (size_t index = count; index > position; --index) {
+      entries[index] = entries[index - 1];
+    }
+    entries[position] = {tick, item};
+    ++count;
+    return true;
+  }
+
+  bool ready(uint64_t now) const
+  {
+    return count > 0 && entries[count - 1].tick <= now;
+  }
+
+  const entry& front() const { return entries[count - 1]; }
+  void pop() { --count; }
+  void clear() { count = 0; }
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+
+private:
+  std::array<entry, Capacity> entries {};
+  size_t count = 0;
+};
+
+}  // namespace am_amp2400
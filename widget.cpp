@@ -1,74 +1,814 @@
 #include <QButtonGroup>
+#include <QCheckBox>
 #include <QComboBox>
+#include <QDir>
+#include <QFileDialog>
 #include <QGridLayout>
 #include <QGroupBox>
+#include <QInputDialog>
+#include <QKeySequence>
 #include <QLabel>
 #include <QLayout>
+#include <QLocale>
 #include <QPushButton>
+#include <QShortcut>
+#include <QSignalBlocker>
+#include <QStandardPaths>
 #include <QTimer>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <utility>
 
 #include "widget.hpp"
 
 #include <rtxi/daq.hpp>
 #include <rtxi/debug.hpp>
+#include <rtxi/rt.hpp>
 
 Q_DECLARE_METATYPE(DAQ::Device*)
 
-am_amp2400::AMAmpComboBox::AMAmpComboBox(QWidget* parent)
-    : QComboBox(parent)
+namespace
 {
-  QObject::connect(
-      this, SIGNAL(currentIndexChanged(int)), this, SLOT(redden()));
+// Pending values are drawn in red. The palette is derived once per widget
+// so marking a widget dirty or clean is a plain setPalette, without the
+// style sheet parsing and re-polishing setStyleSheet triggers.
+QPalette make_dirty_palette(QPalette palette)
+{
+  palette.setColor(QPalette::Text, Qt::red);
+  palette.setColor(QPalette::WindowText, Qt::red);
+  palette.setColor(QPalette::ButtonText, Qt::red);
+  return palette;
 }
+}  // namespace
 
-void am_amp2400::AMAmpComboBox::blacken()
+am_amp2400::AMAmpComboBox::AMAmpComboBox(QWidget* parent)
+    : QComboBox(parent)
+    , clean_palette(palette())
+    , dirty_palette(make_dirty_palette(palette()))
 {
-  this->setStyleSheet("QComboBox { color:black; }");
 }
 
-void am_amp2400::AMAmpComboBox::redden()
+void am_amp2400::AMAmpComboBox::setDirty(bool pending)
 {
-  this->setStyleSheet("QComboBox { color:red; }");
+  if (pending != dirty) {
+    dirty = pending;
+    setPalette(dirty ? dirty_palette : clean_palette);
+  }
 }
 
-/// Create wrapper for QLineEdit. Options go red when changed and black when
-/// 'Set DAQ' is hit.
+/// Create wrapper for QLineEdit. Options go red while they differ from what
+/// was last applied with 'Set DAQ'.
 am_amp2400::AMAmpLineEdit::AMAmpLineEdit(QWidget* parent)
     : QLineEdit(parent)
+    , clean_palette(palette())
+    , dirty_palette(make_dirty_palette(palette()))
 {
-  QObject::connect(
-      this, SIGNAL(textEdited(const QString&)), this, SLOT(redden()));
 }
 
-void am_amp2400::AMAmpLineEdit::blacken()
+void am_amp2400::AMAmpLineEdit::setDirty(bool pending)
 {
-  this->setStyleSheet("QLineEdit { color:black; }");
+  if (pending != dirty) {
+    dirty = pending;
+    setPalette(dirty ? dirty_palette : clean_palette);
+  }
 }
 
-void am_amp2400::AMAmpLineEdit::redden()
+am_amp2400::AMAmpSpinBox::AMAmpSpinBox(QWidget* parent)
+    : QSpinBox(parent)
+    , clean_palette(palette())
+    , dirty_palette(make_dirty_palette(palette()))
 {
-  this->setStyleSheet("QLineEdit { color:red; }");
 }
 
-am_amp2400::AMAmpSpinBox::AMAmpSpinBox(QWidget* parent)
-    : QSpinBox(parent)
+void am_amp2400::AMAmpSpinBox::setDirty(bool pending)
+{
+  if (pending != dirty) {
+    dirty = pending;
+    setPalette(dirty ? dirty_palette : clean_palette);
+  }
+}
+
+namespace
+{
+// Devices are enumerated once and shared by every panel. The list is only
+// touched from the GUI thread; device events merely mark it stale and ask
+// the open panels to refresh.
+struct device_cache
+{
+  std::vector<DAQ::Device*> devices;
+  std::atomic<bool> stale = true;
+  std::mutex panels_mutex;
+  std::vector<am_amp2400::Panel*> panels;
+};
+
+device_cache& shared_devices()
 {
-  QObject::connect(this, SIGNAL(valueChanged(int)), this, SLOT(redden()));
+  static device_cache cache;
+  return cache;
 }
+}  // namespace
 
-void am_amp2400::AMAmpSpinBox::blacken()
+const std::vector<DAQ::Device*>& am_amp2400::Panel::cachedDevices()
 {
-  this->setStyleSheet("QSpinBox { color:black; }");
+  device_cache& cache = shared_devices();
+  if (cache.stale.exchange(false)) {
+    Event::Object device_list_request(Event::Type::DAQ_DEVICE_QUERY_EVENT);
+    this->getRTXIEventManager()->postEvent(&device_list_request);
+    cache.devices = std::any_cast<std::vector<DAQ::Device*>>(
+        device_list_request.getParam("devices"));
+  }
+  return cache.devices;
 }
 
-void am_amp2400::AMAmpSpinBox::redden()
+void am_amp2400::Plugin::receiveEvent(Event::Object* event)
 {
-  this->setStyleSheet("QSpinBox { color:red; }");
+  switch (event->getType()) {
+    case Event::Type::RT_DEVICE_INSERT_EVENT:
+    case Event::Type::RT_DEVICE_REMOVE_EVENT:
+    {
+      device_cache& cache = shared_devices();
+      cache.stale = true;
+      const std::lock_guard<std::mutex> lock(cache.panels_mutex);
+      for (auto* panel : cache.panels) {
+        QMetaObject::invokeMethod(
+            panel,
+            [panel]() { panel->refreshDevices(); },
+            Qt::QueuedConnection);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  Widgets::Plugin::receiveEvent(event);
 }
 
 am_amp2400::Plugin::Plugin(Event::Manager* ev_manager)
     : Widgets::Plugin(ev_manager, std::string(am_amp2400::MODULE_NAME))
 {
+  if (RT::OS::getFifo(this->fifo, am_amp2400::FIFO_CAPACITY) != 0) {
+    ERROR_MSG(
+        "am_amp2400::Plugin::Plugin : Unable to create fifo. Offset "
+        "calibration will not be available");
+  }
+  const QDir directory(
+      QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+  directory.mkpath(".");
+  const std::string log_path =
+      directory.filePath("am-amp2400-state.log").toStdString();
+  if (!state_history.open(log_path)) {
+    ERROR_MSG(
+        "am_amp2400::Plugin::Plugin : Unable to map state log {}. State "
+        "changes will not be recorded",
+        log_path);
+  }
+}
+
+namespace
+{
+am_amp2400::state_entry make_state_entry(int64_t time,
+                                         size_t amp,
+                                         am_amp2400::state_source source,
+                                         const am_amp2400::daq_state& state)
+{
+  return {time,
+          static_cast<uint32_t>(amp),
+          state.mode,
+          source,
+          static_cast<uint32_t>(state.ai_range),
+          state.probe_gain_factor,
+          state.ai_gain,
+          state.ai_offset,
+          state.ao_gain,
+          state.ao_offset,
+          state.telegraph};
+}
+
+// Full scale of a range described as e.g. "-10 to 10" or "[-0.2, 0.2]",
+// i.e. the largest magnitude in the text. 0 if it holds no number.
+double range_full_scale(const std::string& text)
+{
+  double full_scale = 0.0;
+  const char* cursor = text.c_str();
+  while (*cursor != '\0') {
+    char* end = nullptr;
+    const double value = std::strtod(cursor, &end);
+    if (end == cursor) {
+      ++cursor;
+      continue;
+    }
+    if (std::isfinite(value)) {
+      full_scale = std::fmax(full_scale, std::fabs(value));
+    }
+    cursor = end;
+  }
+  return full_scale;
+}
+
+// The shortest text that reads back as the same offset, so that an offset
+// moved by a drift correction is neither shown rounded nor cut short by the
+// next Set DAQ
+QString offset_text(double offset)
+{
+  return QString::number(offset, 'g', QLocale::FloatingPointShortest);
+}
+
+// "AI gain, AO offset" for a mask of daq_setting bits
+std::string describe_settings(uint32_t settings)
+{
+  constexpr std::array<const char*, 5> SETTING_NAMES = {
+      "AI range", "AI gain", "AI offset", "AO gain", "AO offset"};
+  std::string text;
+  for (size_t bit = 0; bit < SETTING_NAMES.size(); ++bit) {
+    if ((settings & (1U << bit)) != 0) {
+      text += text.empty() ? "" : ", ";
+      text += SETTING_NAMES[bit];
+    }
+  }
+  return text;
+}
+}  // namespace
+
+am_amp2400::Component::Component(Widgets::Plugin* plugin)
+    : Widgets::Component(plugin,
+                         std::string(am_amp2400::MODULE_NAME),
+                         am_amp2400::get_default_channels(),
+                         am_amp2400::get_default_vars())
+{
+  // Only am_amp2400::Plugin creates this component, so the host plugin and
+  // its latency histograms are used unchecked from here on
+  host_plugin = dynamic_cast<am_amp2400::Plugin*>(plugin);
+  assert(host_plugin != nullptr);
+  fifo = host_plugin->getFifo();
+  latency = &host_plugin->getLatency();
+  for (size_t amp = 0; amp < MAX_AMPLIFIERS; ++amp) {
+    publishState(amp);
+  }
+}
+
+// Writes the state applied to an amplifier on its outputs. Outputs hold
+// their value, so this only runs when the state changes.
+void am_amp2400::Component::publishState(size_t amp)
+{
+  const daq_state& state = applied_daq[amp].state();
+  const bool applied = applied_daq[amp].valid();
+  writeoutput(state_output(amp, MODE_OUTPUT),
+              double(applied ? state.mode : amp_mode::UNKNOWN));
+  writeoutput(state_output(amp, AI_SCALE_OUTPUT), state.ai_gain);
+  writeoutput(state_output(amp, AO_SCALE_OUTPUT), state.ao_gain);
+  writeoutput(state_output(amp, PROBE_GAIN_OUTPUT), state.probe_gain_factor);
+}
+
+void am_amp2400::Component::execute()
+{
+  switch (this->getState()) {
+    case RT::State::EXEC:
+      ++tick;
+      host_plugin->setTick(tick);
+      processCommands();
+      applyDueTransactions();
+      if (protocol.steps != nullptr) {
+        runProtocol();
+      }
+      if (zero_calibration_active) {
+        accumulateZeroOffset();
+      } else if (drift_config.enabled && !loopback.active()) {
+        trackDrift();
+      }
+      if (auto_range_config.enabled) {
+        runAutoRange();
+      }
+      if (loopback.active()) {
+        runLoopback();
+      } else if (membrane.active()) {
+        runMembraneTest();
+      } else if (bridge.active()) {
+        runBridgeBalance();
+      }
+      if (bridge_correction.enabled) {
+        writeoutput(BRIDGE_CORRECTED_OUTPUT,
+                    readinput(AMPLIFIER_SIGNAL_INPUT)
+                        - bridge_correction.resistance * previous_injected
+                            * amp_profile::iclamp_command_current);
+      }
+      // Written to the output at the end of this period, so it is what the
+      // potential read in the next period answers
+      previous_injected = readinput(CURRENT_COMMAND_INPUT) + bridge.output();
+      if (filter_config.enabled) {
+        writeoutput(FILTERED_OUTPUT,
+                    line_filter.push(readinput(AMPLIFIER_SIGNAL_INPUT)));
+      }
+      break;
+    case RT::State::PERIOD:
+      // The filter sections are designed for the sampling rate
+      configureFilter();
+      this->setState(RT::State::EXEC);
+      break;
+    case RT::State::INIT:
+    case RT::State::MODIFY:
+    case RT::State::UNPAUSE:
+      this->setState(RT::State::EXEC);
+      break;
+    case RT::State::PAUSE:
+      // Partial averages are meaningless once the loop stops sampling
+      if (zero_calibration_active) {
+        abortZeroCalibration();
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+// Drains every pending command without blocking the real-time thread.
+// Every report answers a command, so without a fifo (see Plugin::Plugin)
+// commands are left alone and nothing else writes to it.
+void am_amp2400::Component::processCommands()
+{
+  if (fifo == nullptr) {
+    return;
+  }
+  rt_command command;
+  while (host_plugin->getCommands().try_pop(command)) {
+    switch (command.type) {
+      case command_t::START_ZERO_CALIBRATION:
+        ai_zero_signal.reset(command.zero_calibration.min_samples,
+                             command.zero_calibration.max_samples,
+                             command.zero_calibration.tolerance);
+        ao_zero_signal.reset(command.zero_calibration.min_samples,
+                             command.zero_calibration.max_samples,
+                             command.zero_calibration.tolerance);
+        zero_calibration_active = true;
+        break;
+      case command_t::CANCEL_ZERO_CALIBRATION:
+        zero_calibration_active = false;
+        break;
+      case command_t::APPLY_TRANSACTION:
+        applyTransaction(command.transaction, state_source::SET_DAQ, 0);
+        // A new configuration starts a new baseline
+        ai_drift.reset();
+        break;
+      case command_t::SET_DRIFT_TRACKING:
+        drift_config = command.drift_tracking;
+        ai_drift.configure(drift_config.smoothing_factor,
+                           drift_config.threshold);
+        break;
+      case command_t::SCHEDULE_TRANSACTION:
+        if (!schedule.push(command.scheduled.tick,
+                           command.scheduled.transaction))
+        {
+          rt_report report;
+          report.type = report_t::SCHEDULE_REJECTED;
+          report.transaction = transaction_result {};
+          report.transaction.scheduled = true;
+          report.transaction.scheduled_tick = command.scheduled.tick;
+          fifo->writeRT(&report, sizeof(rt_report));
+        }
+        break;
+      case command_t::CLEAR_SCHEDULE:
+        schedule.clear();
+        break;
+      case command_t::START_MEMBRANE_TEST:
+        bridge.stop();
+        membrane.start(command.membrane_test.cycle_samples,
+                       command.membrane_test.amplitude,
+                       command.membrane_test.sweeps_per_average,
+                       double(RT::OS::getPeriod()) * 1e-9);
+        break;
+      case command_t::STOP_MEMBRANE_TEST:
+        membrane.stop();
+        writeoutput(TEST_PULSE_OUTPUT, 0.0);
+        break;
+      case command_t::START_BRIDGE_BALANCE:
+        membrane.stop();
+        bridge.start(command.bridge_balance.step_samples,
+                     command.bridge_balance.amplitude,
+                     command.bridge_balance.step_current,
+                     command.bridge_balance.steps,
+                     command.bridge_balance.onset_samples);
+        break;
+      case command_t::SET_BRIDGE_CORRECTION:
+        bridge_correction = command.bridge_correction;
+        if (!bridge_correction.enabled) {
+          writeoutput(BRIDGE_CORRECTED_OUTPUT, 0.0);
+        }
+        break;
+      case command_t::START_PROTOCOL:
+        protocol = command.protocol;
+        protocol_next = 0;
+        protocol_step_end = tick;
+        break;
+      case command_t::STOP_PROTOCOL:
+        if (protocol.steps != nullptr) {
+          finishProtocol();
+        }
+        break;
+      case command_t::REAPPLY_STATE:
+        reapplyStates(command.reapply.amp_mask);
+        break;
+      case command_t::START_LOOPBACK:
+        startLoopback(command.loopback);
+        break;
+      case command_t::SET_AUTO_RANGE:
+        auto_range_config = command.auto_range;
+        ai_ranger.configure(auto_range_config.full_scales.data(),
+                            auto_range_config.range_count,
+                            auto_range_config.hold_blocks);
+        range_flag_remaining = 0;
+        writeoutput(RANGE_CHANGE_OUTPUT, 0.0);
+        break;
+      case command_t::SET_FILTER:
+        filter_config = command.filter;
+        configureFilter();
+        if (!filter_config.enabled) {
+          writeoutput(FILTERED_OUTPUT, 0.0);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+// Commits every scheduled transaction due on this tick, earliest first
+void am_amp2400::Component::applyDueTransactions()
+{
+  while (schedule.ready(tick)) {
+    const auto& due = schedule.front();
+    applyTransaction(due.item, state_source::SCHEDULED, due.tick);
+    schedule.pop();
+  }
+}
+
+void am_amp2400::Component::applyTransaction(
+    const mode_transaction& transaction,
+    state_source source,
+    uint64_t scheduled_tick)
+{
+  if (transaction.device == nullptr) {
+    return;
+  }
+  if (transaction.device != shadow_device) {
+    for (auto& shadow : applied_daq) {
+      shadow.invalidate();
+    }
+    shadow_device = transaction.device;
+  }
+  // The new state wins over both the calibration and the state saved for
+  // after it
+  if (loopback.active()
+      && ((transaction.amp_mask & (1U << loopback_amp)) != 0
+          || transaction.device != loopback_device))
+  {
+    loopback.stop();
+    writeoutput(TEST_PULSE_OUTPUT, 0.0);
+    reportLoopback(loopback_result {});
+  }
+  rt_report report;
+  report.type = report_t::TRANSACTION_APPLIED;
+  report.transaction = transaction_result {};
+  report.transaction.scheduled = source == state_source::SCHEDULED;
+  report.transaction.scheduled_tick = scheduled_tick;
+  report.transaction.applied_tick = tick;
+  const int64_t started = RT::OS::getTime();
+  int64_t last_call = started;
+  // Scheduled and protocol transactions wait on purpose, so they would
+  // only skew the Set DAQ latencies
+  const bool immediate = source == state_source::SET_DAQ;
+  if (immediate) {
+    latency->dispatch.record(started - transaction.requested_at);
+  }
+  const auto record_setter = [&]()
+  {
+    const int64_t now = RT::OS::getTime();
+    latency->setter.record(now - last_call);
+    last_call = now;
+  };
+  for (size_t amp = 0; amp < MAX_AMPLIFIERS; ++amp) {
+    if ((transaction.amp_mask & (1U << amp)) != 0) {
+      applied_daq[amp].apply(*transaction.device,
+                             transaction.states[amp],
+                             report.transaction.stats,
+                             record_setter);
+      host_plugin->getStateLog().append(make_state_entry(
+          last_call, amp, source, transaction.states[amp]));
+      publishState(amp);
+    }
+  }
+  // The telegraph levels are the last values handed to the device
+  if (immediate) {
+    latency->total.record(last_call - transaction.requested_at);
+  }
+  publishAppliedStates();
+  fifo->writeRT(&report, sizeof(rt_report));
+}
+
+// Another plugin changed the channels behind the shadows' back, so every
+// setting is written again
+void am_amp2400::Component::reapplyStates(uint32_t amp_mask)
+{
+  if (shadow_device == nullptr) {
+    return;
+  }
+  apply_stats stats {};
+  for (size_t amp = 0; amp < MAX_AMPLIFIERS; ++amp) {
+    if ((amp_mask & (1U << amp)) == 0 || !applied_daq[amp].valid()) {
+      continue;
+    }
+    const daq_state state = applied_daq[amp].state();
+    applied_daq[amp].invalidate();
+    applied_daq[amp].apply(*shadow_device, state, stats);
+    host_plugin->getStateLog().append(make_state_entry(
+        RT::OS::getTime(), amp, state_source::WATCHDOG, state));
+  }
+}
+
+void am_amp2400::Component::publishAppliedStates()
+{
+  applied_snapshot snapshot {};
+  snapshot.device = shadow_device;
+  for (size_t amp = 0; amp < MAX_AMPLIFIERS; ++amp) {
+    snapshot.states[amp] = applied_daq[amp].state();
+    if (applied_daq[amp].valid()) {
+      snapshot.valid_mask |= 1U << amp;
+    }
+  }
+  host_plugin->getAppliedStates().publish(snapshot);
+}
+
+// Commits the next protocol step once the current one has been held for its
+// duration. The steps were compiled by the panel, so a transition is the same
+// transaction as a Set DAQ and nothing is parsed or allocated here.
+void am_amp2400::Component::runProtocol()
+{
+  if (tick < protocol_step_end) {
+    return;
+  }
+  if (protocol_next == protocol.count) {
+    finishProtocol();
+    return;
+  }
+  const protocol_step& step = protocol.steps[protocol_next];
+  if (step.transaction.amp_mask != 0) {
+    applyTransaction(step.transaction, state_source::PROTOCOL, tick);
+  }
+  protocol_step_end = tick + step.duration_ticks;
+  rt_report report;
+  report.type = report_t::PROTOCOL_PROGRESS;
+  report.protocol = {RT::OS::getTime(), protocol_next, false};
+  fifo->writeRT(&report, sizeof(rt_report));
+  ++protocol_next;
+}
+
+// Releases the steps back to the panel
+void am_amp2400::Component::finishProtocol()
+{
+  rt_report report;
+  report.type = report_t::PROTOCOL_PROGRESS;
+  report.protocol = {RT::OS::getTime(), protocol_next, true};
+  fifo->writeRT(&report, sizeof(rt_report));
+  protocol = {};
+}
+
+// Runs the amplifier's channels at unity gain and zero offset for the
+// duration, so that the fit describes the DAQ alone
+void am_amp2400::Component::startLoopback(const loopback_request& request)
+{
+  const size_t amp = request.amp;
+  loopback_amp = amp;
+  if (shadow_device == nullptr || amp >= MAX_AMPLIFIERS
+      || !applied_daq[amp].valid())
+  {
+    reportLoopback(loopback_result {});
+    return;
+  }
+  membrane.stop();
+  bridge.stop();
+  loopback_saved = applied_daq[amp].state();
+  loopback_device = shadow_device;
+  daq_state raw = loopback_saved;
+  raw.ai_gain = 1.0;
+  raw.ai_offset = 0.0;
+  raw.ao_gain = 1.0;
+  raw.ao_offset = 0.0;
+  apply_stats stats {};
+  applied_daq[amp].apply(*shadow_device, raw, stats);
+  host_plugin->getStateLog().append(make_state_entry(
+      RT::OS::getTime(), amp, state_source::CALIBRATION, raw));
+  publishAppliedStates();
+  publishState(amp);
+  loopback.start(request.levels,
+                 request.low,
+                 request.high,
+                 request.settle_samples,
+                 request.average_samples);
+}
+
+// Same sampling order as the membrane test
+void am_amp2400::Component::runLoopback()
+{
+  if (loopback.push(readinput(AMPLIFIER_SIGNAL_INPUT))) {
+    apply_stats stats {};
+    applied_daq[loopback_amp].apply(*shadow_device, loopback_saved, stats);
+    host_plugin->getStateLog().append(
+        make_state_entry(RT::OS::getTime(),
+                         loopback_amp,
+                         state_source::CALIBRATION,
+                         loopback_saved));
+    publishAppliedStates();
+    publishState(loopback_amp);
+    reportLoopback(loopback.result());
+  }
+  writeoutput(TEST_PULSE_OUTPUT, loopback.output());
+}
+
+void am_amp2400::Component::reportLoopback(const loopback_result& fit)
+{
+  const daq_state& state = applied_daq[loopback_amp % MAX_AMPLIFIERS].state();
+  rt_report report;
+  report.type = report_t::LOOPBACK_CALIBRATED;
+  report.loopback = {loopback_device,
+                     loopback_amp,
+                     state.input_channel,
+                     state.output_channel,
+                     state.ai_range,
+                     fit};
+  fifo->writeRT(&report, sizeof(rt_report));
+}
+
+// Moves the tracked amplifier to the AI range its signal needs. The new
+// range and the offset stored for it are set within the period, so no
+// sample pairs one range with the offset of another. The AI gain scales
+// volts and does not depend on the range, so it stays as it is.
+void am_amp2400::Component::runAutoRange()
+{
+  if (range_flag_remaining > 0 && --range_flag_remaining == 0) {
+    writeoutput(RANGE_CHANGE_OUTPUT, 0.0);
+  }
+  const size_t amp = auto_range_config.amp;
+  if (shadow_device == nullptr || amp >= MAX_AMPLIFIERS
+      || !applied_daq[amp].valid() || loopback.active()
+      || ai_ranger.levels() == 0)
+  {
+    return;
+  }
+  const daq_state& state = applied_daq[amp].state();
+  if (state.input_channel != auto_range_config.input_channel
+      || state.ai_gain == 0.0)
+  {
+    return;
+  }
+  // A mode change or the watchdog may have set another range meanwhile
+  size_t level = ai_ranger.level();
+  if (auto_range_config.ranges[level] != state.ai_range) {
+    level = 0;
+    while (level < ai_ranger.levels()
+           && auto_range_config.ranges[level] != state.ai_range)
+    {
+      ++level;
+    }
+    if (level == ai_ranger.levels()) {
+      return;
+    }
+    ai_ranger.set_level(level);
+  }
+  const size_t next =
+      ai_ranger.push(readinput(AMPLIFIER_SIGNAL_INPUT) / state.ai_gain);
+  if (next == level) {
+    return;
+  }
+  daq_state ranged = state;
+  ranged.ai_range = auto_range_config.ranges[next];
+  ranged.ai_offset +=
+      (auto_range_config.offsets[next] - auto_range_config.offsets[level])
+      * state.ai_gain;
+  rt_report report;
+  report.type = report_t::RANGE_CHANGED;
+  report.range = {
+      RT::OS::getTime(), amp, state.ai_range, ranged.ai_range};
+  apply_stats stats {};
+  applied_daq[amp].apply(*shadow_device, ranged, stats);
+  writeoutput(RANGE_CHANGE_OUTPUT, 1.0);
+  range_flag_remaining = auto_range_config.flag_samples;
+  host_plugin->getStateLog().append(make_state_entry(
+      report.range.time, amp, state_source::AUTO_RANGE, ranged));
+  publishAppliedStates();
+  fifo->writeRT(&report, sizeof(rt_report));
+}
+
+// Only trigonometry and a few divisions, so the sections can be designed
+// on the real-time thread whenever the period changes
+void am_amp2400::Component::configureFilter()
+{
+  std::array<biquad, MAX_FILTER_SECTIONS> sections {};
+  const size_t count =
+      design_line_filter(filter_config.line_frequency,
+                         filter_config.harmonics,
+                         filter_config.notch_q,
+                         filter_config.lowpass_cutoff,
+                         1e9 / double(RT::OS::getPeriod()),
+                         sections);
+  line_filter.configure(sections.data(), count);
+}
+
+// Pushes one sample from each zero input. Both inputs are fed in lockstep
+// so they finish on the same period, once both estimates have converged.
+void am_amp2400::Component::accumulateZeroOffset()
+{
+  const bool ai_done = ai_zero_signal.push(readinput(AI_ZERO_INPUT));
+  const bool ao_done = ao_zero_signal.push(readinput(AO_ZERO_INPUT));
+  if (!ai_done || !ao_done) {
+    return;
+  }
+  zero_calibration_active = false;
+  rt_report report;
+  report.type = report_t::ZERO_OFFSET;
+  report.zero_offset.ai_mean = ai_zero_signal.mean();
+  report.zero_offset.ao_mean = ao_zero_signal.mean();
+  report.zero_offset.ai_standard_error = ai_zero_signal.standard_error();
+  report.zero_offset.ao_standard_error = ao_zero_signal.standard_error();
+  report.zero_offset.sample_count = ai_zero_signal.count();
+  fifo->writeRT(&report, sizeof(rt_report));
+}
+
+// Releases the panel, which waits for a result before unlocking the mode
+// controls. No samples means no offset to apply.
+void am_amp2400::Component::abortZeroCalibration()
+{
+  zero_calibration_active = false;
+  rt_report report;
+  report.type = report_t::ZERO_OFFSET;
+  report.zero_offset = zero_offset_result {};
+  fifo->writeRT(&report, sizeof(rt_report));
+}
+
+// The input sampled this period is the response to the previous pulse
+// level, so it is accumulated before the next level is written. Only the
+// samples of the cycle are published, however long the buffer is.
+void am_amp2400::Component::runMembraneTest()
+{
+  if (membrane.push(readinput(AMPLIFIER_SIGNAL_INPUT))) {
+    const membrane_trace& trace = membrane.trace();
+    host_plugin->getMembraneTraces().publish(trace, used_bytes(trace));
+  }
+  writeoutput(TEST_PULSE_OUTPUT, membrane.output());
+}
+
+// Same sampling order as the membrane test. The estimate is only a pair of
+// short line fits, so it is computed right here on the last edge and the
+// correction takes effect on the next period.
+void am_amp2400::Component::runBridgeBalance()
+{
+  if (bridge.push(readinput(AMPLIFIER_SIGNAL_INPUT))) {
+    rt_report report;
+    report.type = report_t::BRIDGE_BALANCED;
+    report.bridge = bridge.estimate();
+    if (report.bridge.valid) {
+      bridge_correction.enabled = true;
+      bridge_correction.resistance = report.bridge.access_resistance;
+    }
+    fifo->writeRT(&report, sizeof(rt_report));
+  }
+  writeoutput(TEST_PULSE_OUTPUT, bridge.output());
+}
+
+// Follows the I=0 input of the tracked amplifier while it is applied in I=0
+// and moves its AI offset whenever the baseline drifts past the threshold.
+// Only the offset setter reaches the device, as the shadow already holds
+// every other setting.
+void am_amp2400::Component::trackDrift()
+{
+  const size_t amp = drift_config.amp;
+  if (shadow_device == nullptr || amp >= MAX_AMPLIFIERS
+      || !applied_daq[amp].valid() || applied_daq[amp].state().mode != IEQ0)
+  {
+    return;
+  }
+  if (!ai_drift.push(readinput(AI_ZERO_INPUT))) {
+    return;
+  }
+  daq_state corrected = applied_daq[amp].state();
+  const double old_offset = corrected.ai_offset;
+  corrected.ai_offset += ai_drift.baseline() * amp_profile::izero_ai_gain;
+  apply_stats stats {};
+  applied_daq[amp].apply(*shadow_device, corrected, stats);
+  ai_drift.reset();
+  publishAppliedStates();
+
+  rt_report report;
+  report.type = report_t::DRIFT_CORRECTION;
+  report.drift.time = RT::OS::getTime();
+  host_plugin->getStateLog().append(make_state_entry(
+      report.drift.time, amp, state_source::DRIFT_CORRECTION, corrected));
+  report.drift.amp = amp;
+  report.drift.old_ai_offset = old_offset;
+  report.drift.new_ai_offset = corrected.ai_offset;
+  fifo->writeRT(&report, sizeof(rt_report));
 }
 
 am_amp2400::Panel::Panel(QMainWindow* main_window, Event::Manager* ev_manager)
@@ -84,22 +824,179 @@ am_amp2400::Panel::Panel(QMainWindow* main_window, Event::Manager* ev_manager)
   // createGUI(am_amp2400::get_default_vars(), {});
   // Get list of devices to control amplifier
 
+  {
+    device_cache& cache = shared_devices();
+    const std::lock_guard<std::mutex> lock(cache.panels_mutex);
+    cache.panels.push_back(this);
+  }
+  this->initParameters();
+  presets.load(presetPath());
+  calibrations.load(calibrationPath());
   this->customizeGUI();
+  this->loadWidgets();
   QTimer::singleShot(0, this, SLOT(resizeMe()));
 }
 
+am_amp2400::Panel::~Panel()
+{
+  {
+    device_cache& cache = shared_devices();
+    const std::lock_guard<std::mutex> lock(cache.panels_mutex);
+    cache.panels.erase(
+        std::remove(cache.panels.begin(), cache.panels.end(), this),
+        cache.panels.end());
+  }
+  // No request may be queued onto the panel once it starts going away
+  control.stop();
+  stopMembraneWorker();
+  if (report_thread.joinable()) {
+    report_thread_running = false;
+    // closing the fifo wakes up the reader blocked in poll
+    hostPlugin()->getFifo()->close();
+    report_thread.join();
+  }
+}
+
+// The host plugin is attached after construction, so the reader thread is
+// started the first time the panel needs to talk to the component.
+am_amp2400::Plugin* am_amp2400::Panel::hostPlugin()
+{
+  auto* amp_plugin = dynamic_cast<am_amp2400::Plugin*>(getHostPlugin());
+  if (amp_plugin == nullptr || amp_plugin->getFifo() == nullptr) {
+    return nullptr;
+  }
+  if (!report_thread.joinable()) {
+    report_thread_running = true;
+    report_thread = std::thread(
+        &am_amp2400::Panel::readReports, this, amp_plugin->getFifo());
+  }
+  return amp_plugin;
+}
+
+void am_amp2400::Panel::readReports(RT::OS::Fifo* fifo)
+{
+  rt_report report;
+  while (report_thread_running) {
+    fifo->poll();
+    while (fifo->read(&report, sizeof(rt_report)) > 0) {
+      QMetaObject::invokeMethod(
+          this,
+          [this, report]() { this->processReport(report); },
+          Qt::QueuedConnection);
+    }
+  }
+}
+
+void am_amp2400::Panel::processReport(const rt_report& report)
+{
+  switch (report.type) {
+    case report_t::ZERO_OFFSET:
+    {
+      setZeroCalibrationActive(false);
+      if (report.zero_offset.sample_count == 0) {
+        logEvent(RT::OS::getTime(),
+                 "Zero offset calibration aborted as the real-time loop "
+                 "was paused");
+        break;
+      }
+      // Offsets are accumulated on top of the ones currently applied, as
+      // the inputs were sampled with those offsets already in effect.
+      amp_config& config = amps[zero_calibration_amp];
+      config.ai_offset +=
+          report.zero_offset.ai_mean * amp_profile::izero_ai_gain;
+      config.ao_offset += report.zero_offset.ao_mean;
+      if (zero_calibration_amp == current_amp) {
+        aiOffsetEdit->setText(offset_text(config.ai_offset));
+        aoOffsetEdit->setText(offset_text(config.ao_offset));
+        scheduleDirtyRefresh();
+      }
+    }
+      break;
+    case report_t::TRANSACTION_APPLIED:
+      daq_stats.issued += report.transaction.stats.issued;
+      daq_stats.skipped += report.transaction.stats.skipped;
+      updateStatsLabel();
+      updateLatencyLabel();
+      if (report.transaction.scheduled) {
+        logEvent(RT::OS::getTime(),
+                 QString("Scheduled switch for tick %1 applied on tick %2")
+                     .arg(static_cast<qulonglong>(
+                         report.transaction.scheduled_tick))
+                     .arg(static_cast<qulonglong>(
+                         report.transaction.applied_tick)));
+      }
+      break;
+    case report_t::SCHEDULE_REJECTED:
+      logEvent(RT::OS::getTime(),
+               QString("Schedule full, switch for tick %1 dropped")
+                   .arg(static_cast<qulonglong>(
+                       report.transaction.scheduled_tick)));
+      break;
+    case report_t::BRIDGE_BALANCED:
+      bridgeBalanceButton->setEnabled(true);
+      if (!report.bridge.valid) {
+        logEvent(RT::OS::getTime(),
+                 QString("Bridge balance failed, voltage jump %1 mV")
+                     .arg(report.bridge.voltage_jump * 1e3));
+        break;
+      }
+      {
+        // The component already corrects with the new estimate
+        const QSignalBlocker box_blocker(bridgeCorrectionBox);
+        const QSignalBlocker edit_blocker(bridgeResistanceEdit);
+        bridgeCorrectionBox->setChecked(true);
+        bridgeResistanceEdit->setText(QString::number(
+            report.bridge.access_resistance * 1e-6, 'f', 2));
+      }
+      logEvent(RT::OS::getTime(),
+               QString("Bridge balanced over %1 edges: Ra %2 MOhm")
+                   .arg(static_cast<qulonglong>(report.bridge.edges))
+                   .arg(report.bridge.access_resistance * 1e-6, 0, 'f', 2));
+      break;
+    case report_t::LOOPBACK_CALIBRATED:
+      showLoopbackResult(report.loopback);
+      break;
+    case report_t::RANGE_CHANGED:
+      logEvent(report.range.time,
+               QString("Amp %1 AI range %2 -> %3")
+                   .arg(static_cast<qulonglong>(report.range.amp + 1))
+                   .arg(static_cast<qulonglong>(report.range.old_range))
+                   .arg(static_cast<qulonglong>(report.range.new_range)));
+      break;
+    case report_t::PROTOCOL_PROGRESS:
+      showProtocolProgress(report.protocol);
+      break;
+    case report_t::DRIFT_CORRECTION:
+    {
+      // Keep the panel in sync so the next Set DAQ does not undo it. The
+      // applied offset may include a stored range offset, so only the
+      // change is carried over.
+      const double change =
+          report.drift.new_ai_offset - report.drift.old_ai_offset;
+      amps[report.drift.amp].ai_offset += change;
+      applied_amps[report.drift.amp].ai_offset += change;
+      if (report.drift.amp == current_amp) {
+        aiOffsetEdit->setText(offset_text(currentAmp().ai_offset));
+      }
+    }
+      logEvent(report.drift.time,
+               QString("Amp %1 drift correction: AI offset %2 -> %3")
+                   .arg(static_cast<qulonglong>(report.drift.amp + 1))
+                   .arg(report.drift.old_ai_offset)
+                   .arg(report.drift.new_ai_offset));
+      break;
+    default:
+      ERROR_MSG("am_amp2400::Panel::processReport : Unknown report type");
+      break;
+  }
+}
+
 void am_amp2400::Panel::initParameters()
 {
-  input_channel = 0;
-  output_channel = 0;
-  mode = amp_mode::IEQ0;
-  ai_offset = 0.0;
-  ao_offset = 0.0;
-  digital_line_0 = 0;
-  digital_line_1 = 0;
-  digital_line_2 = 0;
-  zero_offset = 0;
-  signal_count = 0;
+  amps.fill(DEFAULT_AMP_CONFIG);
+  applied_amps.fill(DEFAULT_AMP_CONFIG);
+  amp_count = 1;
+  current_amp = 0;
 
   // these are amplifier-specific settings.
   // These values used to be assignable in past iterations of this plugin.
@@ -124,21 +1021,26 @@ void am_amp2400::Panel::customizeGUI()
   // QVBoxLayout class that rtxi gives us, so that's what we'll create here.
   auto* widget_layout = new QVBoxLayout;
 
-  // We get a list of devices so that they are available for selection in
-  // the combobox
-  Event::Object device_list_request(Event::Type::DAQ_DEVICE_QUERY_EVENT);
-  this->getRTXIEventManager()->postEvent(&device_list_request);
-  auto devices = std::any_cast<std::vector<DAQ::Device*>>(
-      device_list_request.getParam("devices"));
-
-  auto* devicesComboBox = new QComboBox();
-  for (auto* device : devices) {
-    devicesComboBox->addItem(QString::fromStdString(device->getName()),
-                             QVariant::fromValue(device));
-  }
-
+  // The combobox is filled from the device list shared by every panel
+  devicesComboBox = new QComboBox();
+  refreshDevices();
   widget_layout->addWidget(devicesComboBox);
 
+  // Several amplifiers can share the DAQ. The widgets below edit the one
+  // selected here.
+  auto* ampGroupBox = new QGroupBox("Amplifiers");
+  auto* ampGroupLayout = new QGridLayout;
+  ampGroupBox->setLayout(ampGroupLayout);
+  ampCountBox = new QSpinBox;
+  ampCountBox->setRange(1, static_cast<int>(MAX_AMPLIFIERS));
+  ampGroupLayout->addWidget(new QLabel("Count"), 0, 0);
+  ampGroupLayout->addWidget(ampCountBox, 0, 1);
+  ampSelectComboBox = new QComboBox;
+  ampSelectComboBox->addItem("Amp 1");
+  ampGroupLayout->addWidget(new QLabel("Editing"), 1, 0);
+  ampGroupLayout->addWidget(ampSelectComboBox, 1, 1);
+  widget_layout->addWidget(ampGroupBox);
+
   // create input spinboxes
   auto* ioGroupBox = new QGroupBox("Channels");
   auto* ioGroupLayout = new QGridLayout;
@@ -242,6 +1144,10 @@ void am_amp2400::Panel::customizeGUI()
   ifollowButton = new QRadioButton("IFollow");
   ampButtonGroup->addButton(ifollowButton, IFOLLOW);
 
+  mode_font = vclampButton->font();
+  applied_mode_font = mode_font;
+  applied_mode_font.setBold(true);
+
   auto* ampButtonGroupLayout = new QGridLayout;
   ampButtonGroupLayout->addWidget(vclampButton, 0, 0);
   ampButtonGroupLayout->addWidget(izeroButton, 0, 1);
@@ -251,15 +1157,313 @@ void am_amp2400::Panel::customizeGUI()
   ampButtonGroupLayout->addWidget(iresistButton, 2, 1);
   ampButtonGroupLayout->addWidget(ifollowButton, 3, 0);
 
+  // I=0 calibration is carried out by the real-time component
+  findZeroButton = new QPushButton("Find Zero Offset");
+  findZeroButton->setToolTip(
+      "Average the I=0 inputs and add the result to the AI/AO offsets");
+  auto* zeroLayout = new QGridLayout;
+  zeroLayout->addWidget(findZeroButton, 0, 0);
+  zeroLayout->addWidget(new QLabel("Tolerance (V):"), 0, 1);
+  zeroToleranceEdit = new QLineEdit(QString::number(DEFAULT_ZERO_TOLERANCE));
+  zeroToleranceEdit->setValidator(
+      new QDoubleValidator(0.0, 1.0, 9, zeroToleranceEdit));
+  zeroToleranceEdit->setToolTip(
+      "Averaging stops once the standard error of the mean is below this "
+      "value");
+  zeroLayout->addWidget(zeroToleranceEdit, 0, 2);
+  ampModeGroupLayout->addLayout(zeroLayout, 6, 0);
+
   // We add our own set daq button
   auto* setDaqButton = new QPushButton("Set DAQ");
+  auto* applyAllButton = new QPushButton("Apply All");
+  applyAllButton->setToolTip(
+      "Configure every amplifier in one real-time period");
 
   ampModeGroupLayout->addLayout(ampButtonGroupLayout, 5, 0);
 
+  // Optional background tracking of the I=0 offset
+  driftGroupBox = new QGroupBox("I=0 Drift Tracking");
+  driftGroupBox->setCheckable(true);
+  driftGroupBox->setChecked(false);
+  auto* driftLayout = new QGridLayout;
+  driftGroupBox->setLayout(driftLayout);
+  driftLayout->addWidget(new QLabel("Time constant (s):"), 0, 0);
+  driftTimeConstantEdit = new QLineEdit("10");
+  driftTimeConstantEdit->setValidator(
+      new QDoubleValidator(0.001, 1e6, 3, driftTimeConstantEdit));
+  driftLayout->addWidget(driftTimeConstantEdit, 0, 1);
+  driftLayout->addWidget(new QLabel("Threshold (V):"), 1, 0);
+  driftThresholdEdit = new QLineEdit("0.001");
+  driftThresholdEdit->setValidator(
+      new QDoubleValidator(0.0, 10.0, 9, driftThresholdEdit));
+  driftLayout->addWidget(driftThresholdEdit, 1, 1);
+
+  // Mode switches can be queued on the real-time component, which applies
+  // them on an exact period
+  auto* scheduleGroupBox = new QGroupBox("Scheduled Switch");
+  auto* scheduleLayout = new QGridLayout;
+  scheduleGroupBox->setLayout(scheduleLayout);
+  scheduleLayout->addWidget(new QLabel("Delay (ms):"), 0, 0);
+  scheduleDelayEdit = new QLineEdit("100");
+  scheduleDelayEdit->setValidator(
+      new QDoubleValidator(0.0, 1e9, 3, scheduleDelayEdit));
+  scheduleLayout->addWidget(scheduleDelayEdit, 0, 1);
+  auto* scheduleButton = new QPushButton("Schedule");
+  scheduleButton->setToolTip(
+      "Apply the amplifier being edited after the given delay, on an exact "
+      "real-time period");
+  scheduleLayout->addWidget(scheduleButton, 1, 0);
+  auto* clearScheduleButton = new QPushButton("Clear");
+  scheduleLayout->addWidget(clearScheduleButton, 1, 1);
+
+  // Presets hold the configuration of one amplifier. Ctrl+1..9 recalls the
+  // matching preset onto the amplifier being edited and applies it.
+  auto* presetGroupBox = new QGroupBox("Presets");
+  auto* presetLayout = new QGridLayout;
+  presetGroupBox->setLayout(presetLayout);
+  presetComboBox = new QComboBox;
+  presetLayout->addWidget(presetComboBox, 0, 0, 1, 3);
+  auto* savePresetButton = new QPushButton("Save");
+  savePresetButton->setToolTip(
+      "Store the amplifier being edited in the selected preset");
+  presetLayout->addWidget(savePresetButton, 1, 0);
+  auto* recallPresetButton = new QPushButton("Recall");
+  recallPresetButton->setToolTip(
+      "Load the selected preset into the amplifier being edited and apply "
+      "it");
+  presetLayout->addWidget(recallPresetButton, 1, 1);
+  auto* clearPresetButton = new QPushButton("Clear");
+  presetLayout->addWidget(clearPresetButton, 1, 2);
+  refreshPresetNames();
+
+  // Seal and membrane test, run by the real-time component in VTest
+  auto* membraneGroupBox = new QGroupBox("Membrane Test");
+  auto* membraneLayout = new QGridLayout;
+  membraneGroupBox->setLayout(membraneLayout);
+  membraneLayout->addWidget(new QLabel("Amplitude (mV):"), 0, 0);
+  membraneAmplitudeEdit = new QLineEdit("10");
+  membraneAmplitudeEdit->setValidator(
+      new QDoubleValidator(-200.0, 200.0, 3, membraneAmplitudeEdit));
+  membraneLayout->addWidget(membraneAmplitudeEdit, 0, 1);
+  membraneLayout->addWidget(new QLabel("Pulse width (ms):"), 1, 0);
+  membranePulseEdit = new QLineEdit("10");
+  membranePulseEdit->setValidator(
+      new QDoubleValidator(0.1, 1000.0, 3, membranePulseEdit));
+  membraneLayout->addWidget(membranePulseEdit, 1, 1);
+  membraneTestButton = new QPushButton("Run");
+  membraneTestButton->setCheckable(true);
+  membraneTestButton->setToolTip(
+      "Send a square pulse on the Test Pulse output and fit the averaged "
+      "response on the Amplifier Signal input");
+  membraneLayout->addWidget(membraneTestButton, 2, 0);
+  membraneResultLabel = new QLabel;
+  membraneLayout->addWidget(membraneResultLabel, 3, 0, 1, 2);
+
+  // Bridge balance, run by the real-time component in IClamp
+  auto* bridgeGroupBox = new QGroupBox("Bridge Balance");
+  auto* bridgeLayout = new QGridLayout;
+  bridgeGroupBox->setLayout(bridgeLayout);
+  bridgeLayout->addWidget(new QLabel("Step (pA):"), 0, 0);
+  bridgeStepEdit = new QLineEdit("100");
+  bridgeStepEdit->setValidator(
+      new QDoubleValidator(-10000.0, 10000.0, 1, bridgeStepEdit));
+  bridgeLayout->addWidget(bridgeStepEdit, 0, 1);
+  bridgeLayout->addWidget(new QLabel("Step width (ms):"), 1, 0);
+  bridgeWidthEdit = new QLineEdit("5");
+  bridgeWidthEdit->setValidator(
+      new QDoubleValidator(0.1, 1000.0, 3, bridgeWidthEdit));
+  bridgeLayout->addWidget(bridgeWidthEdit, 1, 1);
+  bridgeLayout->addWidget(new QLabel("Steps:"), 2, 0);
+  bridgeStepCountBox = new QSpinBox;
+  bridgeStepCountBox->setRange(1, 1000);
+  bridgeStepCountBox->setValue(20);
+  bridgeLayout->addWidget(bridgeStepCountBox, 2, 1);
+  bridgeBalanceButton = new QPushButton("Balance");
+  bridgeBalanceButton->setToolTip(
+      "Inject the step train on the Test Pulse output and measure the "
+      "access resistance from the voltage jumps");
+  bridgeLayout->addWidget(bridgeBalanceButton, 3, 0);
+  bridgeCorrectionBox = new QCheckBox("Correct (MOhm):");
+  bridgeCorrectionBox->setToolTip(
+      "Publish the potential minus the drop across this resistance on the "
+      "Bridge Corrected Potential output");
+  bridgeLayout->addWidget(bridgeCorrectionBox, 4, 0);
+  bridgeResistanceEdit = new QLineEdit("0");
+  bridgeResistanceEdit->setValidator(
+      new QDoubleValidator(0.0, 1000.0, 3, bridgeResistanceEdit));
+  bridgeLayout->addWidget(bridgeResistanceEdit, 4, 1);
+
+  // Characterises the DAQ channels of the amplifier being edited, with its
+  // analog output wired straight to its analog input
+  auto* loopbackGroupBox = new QGroupBox("Loopback Calibration");
+  auto* loopbackLayout = new QGridLayout;
+  loopbackGroupBox->setLayout(loopbackLayout);
+  loopbackLayout->addWidget(new QLabel("Range (V):"), 0, 0);
+  loopbackLowEdit = new QLineEdit("-5");
+  loopbackLowEdit->setValidator(
+      new QDoubleValidator(-10.0, 10.0, 3, loopbackLowEdit));
+  loopbackLayout->addWidget(loopbackLowEdit, 0, 1);
+  loopbackHighEdit = new QLineEdit("5");
+  loopbackHighEdit->setValidator(
+      new QDoubleValidator(-10.0, 10.0, 3, loopbackHighEdit));
+  loopbackLayout->addWidget(loopbackHighEdit, 0, 2);
+  loopbackLayout->addWidget(new QLabel("Levels:"), 1, 0);
+  loopbackLevelsBox = new QSpinBox;
+  loopbackLevelsBox->setRange(2, static_cast<int>(MAX_LOOPBACK_LEVELS));
+  loopbackLevelsBox->setValue(11);
+  loopbackLayout->addWidget(loopbackLevelsBox, 1, 1);
+  loopbackLayout->addWidget(new QLabel("Settle / average (ms):"), 2, 0);
+  loopbackSettleEdit = new QLineEdit("10");
+  loopbackSettleEdit->setValidator(
+      new QDoubleValidator(0.0, 10000.0, 3, loopbackSettleEdit));
+  loopbackLayout->addWidget(loopbackSettleEdit, 2, 1);
+  loopbackAverageEdit = new QLineEdit("50");
+  loopbackAverageEdit->setValidator(
+      new QDoubleValidator(0.1, 10000.0, 3, loopbackAverageEdit));
+  loopbackLayout->addWidget(loopbackAverageEdit, 2, 2);
+  loopbackButton = new QPushButton("Calibrate");
+  loopbackButton->setToolTip(
+      "Step the Test Pulse output through the range at unity gain and fit "
+      "the Amplifier Signal input against it");
+  loopbackLayout->addWidget(loopbackButton, 3, 0);
+  auto* forgetCalibrationButton = new QPushButton("Forget");
+  forgetCalibrationButton->setToolTip(
+      "Drop the loop offset stored for the channels of the amplifier being "
+      "edited at the range of its mode");
+  loopbackLayout->addWidget(forgetCalibrationButton, 3, 1);
+  calibrationBox = new QCheckBox("Use stored loopback offsets");
+  calibrationBox->setChecked(true);
+  calibrationBox->setToolTip(
+      "Add the loop offset (AO plus AI) measured for the amplifier's "
+      "channels at the range a mode uses to the AI offset whenever the mode "
+      "is applied");
+  loopbackLayout->addWidget(calibrationBox, 4, 0, 1, 3);
+  loopbackResultLabel = new QLabel;
+  loopbackLayout->addWidget(loopbackResultLabel, 5, 0, 1, 3);
+
+  // Optional choice of the AI range by the real-time component
+  autoRangeGroupBox = new QGroupBox("AI Auto-Ranging");
+  autoRangeGroupBox->setCheckable(true);
+  autoRangeGroupBox->setChecked(false);
+  autoRangeGroupBox->setToolTip(
+      "Move the AI channel of the amplifier being edited to the narrowest "
+      "range its signal fits in");
+  auto* autoRangeLayout = new QGridLayout;
+  autoRangeGroupBox->setLayout(autoRangeLayout);
+  autoRangeLayout->addWidget(new QLabel("Hold (ms):"), 0, 0);
+  autoRangeHoldEdit = new QLineEdit("500");
+  autoRangeHoldEdit->setToolTip(
+      "How long the signal must stay small before a narrower range is used");
+  autoRangeHoldEdit->setValidator(
+      new QDoubleValidator(0.0, 1e6, 3, autoRangeHoldEdit));
+  autoRangeLayout->addWidget(autoRangeHoldEdit, 0, 1);
+  autoRangeLayout->addWidget(new QLabel("Flag (ms):"), 1, 0);
+  autoRangeFlagEdit = new QLineEdit("1");
+  autoRangeFlagEdit->setToolTip(
+      "How long AI Range Change stays at 1 after a change, to let the "
+      "input settle");
+  autoRangeFlagEdit->setValidator(
+      new QDoubleValidator(0.0, 10000.0, 3, autoRangeFlagEdit));
+  autoRangeLayout->addWidget(autoRangeFlagEdit, 1, 1);
+
+  // One shared filtered copy of the amplifier signal for other modules
+  filterGroupBox = new QGroupBox("Line Noise Filter");
+  filterGroupBox->setCheckable(true);
+  filterGroupBox->setChecked(false);
+  filterGroupBox->setToolTip(
+      "Write Amplifier Signal with line noise notched out and low-pass "
+      "filtered to Filtered Signal");
+  auto* filterLayout = new QGridLayout;
+  filterGroupBox->setLayout(filterLayout);
+  filterLayout->addWidget(new QLabel("Line (Hz):"), 0, 0);
+  filterLineComboBox = new QComboBox;
+  filterLineComboBox->addItem("50");
+  filterLineComboBox->addItem("60");
+  filterLayout->addWidget(filterLineComboBox, 0, 1);
+  filterLayout->addWidget(new QLabel("Harmonics:"), 1, 0);
+  filterHarmonicsBox = new QSpinBox;
+  filterHarmonicsBox->setRange(0, static_cast<int>(MAX_LINE_HARMONICS));
+  filterHarmonicsBox->setValue(3);
+  filterHarmonicsBox->setToolTip(
+      "Number of notches, at the line frequency and its multiples");
+  filterLayout->addWidget(filterHarmonicsBox, 1, 1);
+  filterLayout->addWidget(new QLabel("Notch Q:"), 2, 0);
+  filterNotchQEdit = new QLineEdit("30");
+  filterNotchQEdit->setValidator(
+      new QDoubleValidator(0.5, 1000.0, 3, filterNotchQEdit));
+  filterLayout->addWidget(filterNotchQEdit, 2, 1);
+  filterLayout->addWidget(new QLabel("Low-pass (Hz):"), 3, 0);
+  filterLowpassEdit = new QLineEdit("2000");
+  filterLowpassEdit->setToolTip("4th order Butterworth, 0 turns it off");
+  filterLowpassEdit->setValidator(
+      new QDoubleValidator(0.0, 1e6, 3, filterLowpassEdit));
+  filterLayout->addWidget(filterLowpassEdit, 3, 1);
+
+  // Reads back the channels of the applied amplifiers now and then, in case
+  // another plugin changed them
+  watchdogGroupBox = new QGroupBox("DAQ Watchdog");
+  watchdogGroupBox->setCheckable(true);
+  watchdogGroupBox->setChecked(true);
+  auto* watchdogLayout = new QGridLayout;
+  watchdogGroupBox->setLayout(watchdogLayout);
+  watchdogLayout->addWidget(new QLabel("Interval (s):"), 0, 0);
+  watchdogIntervalEdit = new QLineEdit("1");
+  watchdogIntervalEdit->setValidator(
+      new QDoubleValidator(0.1, 3600.0, 3, watchdogIntervalEdit));
+  watchdogLayout->addWidget(watchdogIntervalEdit, 0, 1);
+  watchdogRepairBox = new QCheckBox("Re-apply on mismatch");
+  watchdogRepairBox->setToolTip(
+      "Write the applied state again instead of only warning");
+  watchdogLayout->addWidget(watchdogRepairBox, 1, 0, 1, 2);
+  watchdogTimer = new QTimer(this);
+
+  // Protocols are parsed once into steps that the component runs on its own
+  auto* protocolGroupBox = new QGroupBox("Protocol");
+  auto* protocolLayout = new QGridLayout;
+  protocolGroupBox->setLayout(protocolLayout);
+  protocolRunButton = new QPushButton("Run...");
+  protocolRunButton->setToolTip(
+      "Load a protocol file and run its steps from the real-time component");
+  protocolLayout->addWidget(protocolRunButton, 0, 0);
+  protocolStopButton = new QPushButton("Stop");
+  protocolStopButton->setEnabled(false);
+  protocolLayout->addWidget(protocolStopButton, 0, 1);
+  protocolStatusLabel = new QLabel;
+  protocolLayout->addWidget(protocolStatusLabel, 1, 0, 1, 2);
+
+  controlSocketBox = new QCheckBox("Control socket");
+  controlSocketBox->setToolTip(
+      QString("Accept commands from other processes on %1")
+          .arg(QString::fromStdString(controlSocketPath())));
+
+  eventLog = new QPlainTextEdit;
+  eventLog->setReadOnly(true);
+  eventLog->setMaximumBlockCount(1000);
+
+  daqStatsLabel = new QLabel;
+  updateStatsLabel();
+  latencyLabel = new QLabel;
+  updateLatencyLabel();
+
   // add widgets to custom layout
   widget_layout->addWidget(ioGroupBox);
   widget_layout->addWidget(ampModeGroupBox);
+  widget_layout->addWidget(driftGroupBox);
+  widget_layout->addWidget(scheduleGroupBox);
+  widget_layout->addWidget(presetGroupBox);
+  widget_layout->addWidget(membraneGroupBox);
+  widget_layout->addWidget(bridgeGroupBox);
+  widget_layout->addWidget(loopbackGroupBox);
+  widget_layout->addWidget(autoRangeGroupBox);
+  widget_layout->addWidget(filterGroupBox);
+  widget_layout->addWidget(protocolGroupBox);
+  widget_layout->addWidget(watchdogGroupBox);
+  widget_layout->addWidget(controlSocketBox);
   widget_layout->addWidget(setDaqButton);
+  widget_layout->addWidget(applyAllButton);
+  widget_layout->addWidget(daqStatsLabel);
+  widget_layout->addWidget(latencyLabel);
+  widget_layout->addWidget(eventLog);
   setLayout(widget_layout);
 
   // connect the widgets to the signals
@@ -289,379 +1493,1409 @@ void am_amp2400::Panel::customizeGUI()
                    QOverload<int>::of(&QComboBox::currentIndexChanged),
                    this,
                    &am_amp2400::Panel::setProbeGain);
+  // Every edit re-evaluates which widgets hold unapplied values
+  for (auto* box : {inputBox, outputBox, bit1Box, bit2Box, bit4Box}) {
+    QObject::connect(box,
+                     QOverload<int>::of(&AMAmpSpinBox::valueChanged),
+                     this,
+                     &am_amp2400::Panel::scheduleDirtyRefresh);
+  }
+  for (auto* edit : {aiOffsetEdit, aoOffsetEdit}) {
+    QObject::connect(edit,
+                     &AMAmpLineEdit::textChanged,
+                     this,
+                     &am_amp2400::Panel::scheduleDirtyRefresh);
+  }
+  QObject::connect(probeGainComboBox,
+                   QOverload<int>::of(&QComboBox::currentIndexChanged),
+                   this,
+                   &am_amp2400::Panel::scheduleDirtyRefresh);
+  QObject::connect(ampButtonGroup,
+                   &QButtonGroup::idClicked,
+                   this,
+                   &am_amp2400::Panel::scheduleDirtyRefresh);
   QObject::connect(
-      setDaqButton, &QPushButton::clicked, this, &am_amp2400::Panel::updateDAQ);
+      setDaqButton, &QPushButton::clicked, this, &am_amp2400::Panel::modify);
+  QObject::connect(findZeroButton,
+                   &QPushButton::clicked,
+                   this,
+                   &am_amp2400::Panel::findZeroOffset);
+  QObject::connect(devicesComboBox,
+                   QOverload<int>::of(&QComboBox::currentIndexChanged),
+                   this,
+                   &am_amp2400::Panel::selectDevice);
+  QObject::connect(driftGroupBox,
+                   &QGroupBox::toggled,
+                   this,
+                   &am_amp2400::Panel::updateDriftTracking);
+  QObject::connect(driftTimeConstantEdit,
+                   &QLineEdit::editingFinished,
+                   this,
+                   &am_amp2400::Panel::updateDriftTracking);
+  QObject::connect(driftThresholdEdit,
+                   &QLineEdit::editingFinished,
+                   this,
+                   &am_amp2400::Panel::updateDriftTracking);
+  QObject::connect(scheduleButton,
+                   &QPushButton::clicked,
+                   this,
+                   &am_amp2400::Panel::scheduleSwitch);
+  QObject::connect(clearScheduleButton,
+                   &QPushButton::clicked,
+                   this,
+                   &am_amp2400::Panel::clearSchedule);
+  QObject::connect(membraneTestButton,
+                   &QPushButton::toggled,
+                   this,
+                   &am_amp2400::Panel::toggleMembraneTest);
+  QObject::connect(bridgeBalanceButton,
+                   &QPushButton::clicked,
+                   this,
+                   &am_amp2400::Panel::balanceBridge);
+  QObject::connect(bridgeCorrectionBox,
+                   &QCheckBox::toggled,
+                   this,
+                   &am_amp2400::Panel::updateBridgeCorrection);
+  QObject::connect(bridgeResistanceEdit,
+                   &QLineEdit::editingFinished,
+                   this,
+                   &am_amp2400::Panel::updateBridgeCorrection);
+  QObject::connect(loopbackButton,
+                   &QPushButton::clicked,
+                   this,
+                   &am_amp2400::Panel::calibrateLoopback);
+  QObject::connect(forgetCalibrationButton,
+                   &QPushButton::clicked,
+                   this,
+                   &am_amp2400::Panel::forgetCalibration);
+  QObject::connect(autoRangeGroupBox,
+                   &QGroupBox::toggled,
+                   this,
+                   &am_amp2400::Panel::updateAutoRange);
+  QObject::connect(autoRangeHoldEdit,
+                   &QLineEdit::editingFinished,
+                   this,
+                   &am_amp2400::Panel::updateAutoRange);
+  QObject::connect(autoRangeFlagEdit,
+                   &QLineEdit::editingFinished,
+                   this,
+                   &am_amp2400::Panel::updateAutoRange);
+  QObject::connect(filterGroupBox,
+                   &QGroupBox::toggled,
+                   this,
+                   &am_amp2400::Panel::updateFilter);
+  QObject::connect(filterLineComboBox,
+                   QOverload<int>::of(&QComboBox::currentIndexChanged),
+                   this,
+                   &am_amp2400::Panel::updateFilter);
+  QObject::connect(filterHarmonicsBox,
+                   QOverload<int>::of(&QSpinBox::valueChanged),
+                   this,
+                   &am_amp2400::Panel::updateFilter);
+  QObject::connect(filterNotchQEdit,
+                   &QLineEdit::editingFinished,
+                   this,
+                   &am_amp2400::Panel::updateFilter);
+  QObject::connect(filterLowpassEdit,
+                   &QLineEdit::editingFinished,
+                   this,
+                   &am_amp2400::Panel::updateFilter);
+  QObject::connect(watchdogGroupBox,
+                   &QGroupBox::toggled,
+                   this,
+                   &am_amp2400::Panel::updateWatchdog);
+  QObject::connect(watchdogIntervalEdit,
+                   &QLineEdit::editingFinished,
+                   this,
+                   &am_amp2400::Panel::updateWatchdog);
+  QObject::connect(watchdogTimer,
+                   &QTimer::timeout,
+                   this,
+                   &am_amp2400::Panel::checkWatchdog);
+  updateWatchdog();
+  QObject::connect(protocolRunButton,
+                   &QPushButton::clicked,
+                   this,
+                   &am_amp2400::Panel::runProtocol);
+  QObject::connect(protocolStopButton,
+                   &QPushButton::clicked,
+                   this,
+                   &am_amp2400::Panel::stopProtocol);
+  QObject::connect(controlSocketBox,
+                   &QCheckBox::toggled,
+                   this,
+                   &am_amp2400::Panel::toggleControlSocket);
+  QObject::connect(savePresetButton,
+                   &QPushButton::clicked,
+                   this,
+                   &am_amp2400::Panel::savePreset);
+  QObject::connect(recallPresetButton,
+                   &QPushButton::clicked,
+                   this,
+                   &am_amp2400::Panel::recallSelectedPreset);
+  QObject::connect(clearPresetButton,
+                   &QPushButton::clicked,
+                   this,
+                   &am_amp2400::Panel::clearPreset);
+  for (size_t slot = 0; slot < NUM_PRESETS; ++slot) {
+    auto* shortcut = new QShortcut(
+        QKeySequence(Qt::CTRL + Qt::Key_1 + static_cast<int>(slot)), this);
+    QObject::connect(shortcut, &QShortcut::activated, this, [this, slot]() {
+      this->recallPreset(slot);
+    });
+  }
+  QObject::connect(applyAllButton,
+                   &QPushButton::clicked,
+                   this,
+                   &am_amp2400::Panel::applyAll);
+  QObject::connect(ampCountBox,
+                   QOverload<int>::of(&QSpinBox::valueChanged),
+                   this,
+                   &am_amp2400::Panel::setAmplifierCount);
+  QObject::connect(ampSelectComboBox,
+                   QOverload<int>::of(&QComboBox::currentIndexChanged),
+                   this,
+                   &am_amp2400::Panel::selectAmplifier);
 }
 
-void am_amp2400::Panel::setProbeGain(int index)
+// Rebuilds the device combobox from the shared cache, keeping the current
+// selection when the device is still around.
+void am_amp2400::Panel::refreshDevices()
 {
-  if (index > 2) {
-    ERROR_MSG(
-        "am_amp2400::Panel::setProbeGain : Invalid index passed. Check amp "
-        "implementation");
-    return;
+  const auto& devices = cachedDevices();
+  {
+    const QSignalBlocker blocker(devicesComboBox);
+    devicesComboBox->clear();
+    for (auto* device : devices) {
+      devicesComboBox->addItem(QString::fromStdString(device->getName()),
+                               QVariant::fromValue(device));
+    }
+    const int index =
+        devicesComboBox->findData(QVariant::fromValue(current_device));
+    devicesComboBox->setCurrentIndex(index >= 0 ? index : 0);
   }
-  mode = amp_mode(index);
+  selectDevice(devicesComboBox->currentIndex());
 }
 
-void am_amp2400::Panel::updateDAQ()
+void am_amp2400::Panel::selectDevice(int index)
 {
-  switch (this->mode) {
-    case amp_mode::VCLAMP:  // VClamp
-      if (current_device != nullptr) {
-        current_device->setAnalogRange(DAQ::ChannelType::AI, input_channel, 0);
-        current_device->setAnalogGain(
-            DAQ::ChannelType::AI, input_channel, vclamp_ai_gain);
-        current_device->setAnalogZeroOffset(
-            DAQ::ChannelType::AI, input_channel, ai_offset);
-        current_device->setAnalogGain(
-            DAQ::ChannelType::AO, output_channel, vclamp_ao_gain);
-        current_device->setAnalogZeroOffset(
-            DAQ::ChannelType::AO, output_channel, ao_offset);
-      }
-
-      current_device->writeinput(digital_line_0, 0.0);
-      current_device->writeinput(digital_line_1, 5.0);
-      current_device->writeinput(digital_line_2, 0.0);
-      break;
-
-    case amp_mode::IEQ0:  // I = 0
-      if (current_device != nullptr) {
-        current_device->setAnalogRange(DAQ::ChannelType::AI, input_channel, 3);
-        current_device->setAnalogGain(
-            DAQ::ChannelType::AI, input_channel, izero_ai_gain);
-        current_device->setAnalogZeroOffset(
-            DAQ::ChannelType::AI, input_channel, ai_offset);
-        current_device->setAnalogGain(DAQ::ChannelType::AO,
-                                      output_channel,
-                                      izero_ao_gain * probe_gain_factor);
-        current_device->setAnalogZeroOffset(
-            DAQ::ChannelType::AO, output_channel, ao_offset);
-      }
-
-      current_device->writeinput(digital_line_0, 5.0);
-      current_device->writeinput(digital_line_1, 5.0);
-      current_device->writeinput(digital_line_2, 0.0);
+  auto* device = index >= 0
+      ? devicesComboBox->itemData(index).value<DAQ::Device*>()
+      : nullptr;
+  if (device == current_device) {
+    return;
+  }
+  current_device = device;
+  // Nothing is known about the channels of the new device
+  for (auto& shadow : applied_daq) {
+    shadow.invalidate();
+  }
+}
 
-      break;
+void am_amp2400::Panel::setProbeGain(int index)
+{
+  if (index < 0 || index > HIGH) {
+    ERROR_MSG(
+        "am_amp2400::Panel::setProbeGain : Invalid index passed. Check amp "
+        "implementation");
+    return;
+  }
+  currentAmp().probe_gain = probe_gain_t(index);
+}
 
-    case amp_mode::ICLAMP:  // IClamp
-      if (current_device != nullptr) {
-        current_device->setAnalogRange(DAQ::ChannelType::AI, input_channel, 3);
-        current_device->setAnalogGain(
-            DAQ::ChannelType::AI, input_channel, iclamp_ai_gain);
-        current_device->setAnalogZeroOffset(
-            DAQ::ChannelType::AI, input_channel, ai_offset);
-        current_device->setAnalogGain(
-            DAQ::ChannelType::AO, output_channel, iclamp_ao_gain);
-        current_device->setAnalogZeroOffset(
-            DAQ::ChannelType::AO, output_channel, ao_offset);
+// Applies the amplifiers selected in amp_mask in a single transaction
+void am_amp2400::Panel::updateDAQ(int64_t requested_at, uint32_t amp_mask)
+{
+  if (current_device == nullptr) {
+    ERROR_MSG("am_amp2400::Panel::updateDAQ : No DAQ device selected");
+    return;
+  }
+  rt_command command;
+  command.type = command_t::APPLY_TRANSACTION;
+  command.transaction.device = current_device;
+  command.transaction.amp_mask = 0;
+  command.transaction.requested_at = requested_at;
+  for (size_t amp = 0; amp < amp_count; ++amp) {
+    if ((amp_mask & (1U << amp)) == 0) {
+      continue;
+    }
+    if (!valid_mode(amps[amp].mode)) {
+      ERROR_MSG(
+          "ERROR. Something went horribly wrong. The amplifier mode "
+          "is set to an unknown value");
+      return;
+    }
+    command.transaction.states[amp] = resolveState(amps[amp]);
+    command.transaction.amp_mask |= 1U << amp;
+  }
+  const auto mark_applied = [&]()
+  {
+    for (size_t amp = 0; amp < MAX_AMPLIFIERS; ++amp) {
+      if ((command.transaction.amp_mask & (1U << amp)) != 0) {
+        applied_amps[amp] = amps[amp];
       }
-      current_device->writeinput(digital_line_0, 0.0);
-      current_device->writeinput(digital_line_1, 0.0);
-      current_device->writeinput(digital_line_2, 5.0);
-      break;
-
-    case amp_mode::VCOMP:  // VComp
-      if (current_device != nullptr) {
-        current_device->setAnalogRange(DAQ::ChannelType::AI, input_channel, 0);
-        current_device->setAnalogGain(
-            DAQ::ChannelType::AI, input_channel, vclamp_ai_gain);
-        current_device->setAnalogZeroOffset(
-            DAQ::ChannelType::AI, input_channel, ai_offset);
-        current_device->setAnalogGain(
-            DAQ::ChannelType::AO, output_channel, vclamp_ao_gain);
-        current_device->setAnalogZeroOffset(
-            DAQ::ChannelType::AO, output_channel, ao_offset);
+    }
+    scheduleDirtyRefresh();
+    // The test pulse would be misread in any other mode
+    if (membraneTestButton->isChecked()
+        && applied_amps[current_amp].mode != amp_mode::VTEST)
+    {
+      membraneTestButton->setChecked(false);
+    }
+  };
+  switch (postCommand(command)) {
+    case post_result::POSTED:
+      // The component keeps its own shadows from now on
+      for (auto& shadow : applied_daq) {
+        shadow.invalidate();
       }
-
-      current_device->writeinput(digital_line_0, 5.0);
-      current_device->writeinput(digital_line_1, 0.0);
-      current_device->writeinput(digital_line_2, 0.0);
+      mark_applied();
+      return;
+    case post_result::QUEUE_FULL:
+      // The component still owns the device, so nothing is written from
+      // here and the edits stay pending
+      ERROR_MSG(
+          "am_amp2400::Panel::updateDAQ : The real-time component is not "
+          "taking commands. Settings not applied");
+      logEvent(RT::OS::getTime(),
+               "Settings not applied: the real-time component is not taking "
+               "commands");
+      return;
+    case post_result::NO_COMPONENT:
       break;
-
-    case amp_mode::VTEST:  // VTest
-      if (current_device != nullptr) {
-        current_device->setAnalogRange(DAQ::ChannelType::AI, input_channel, 0);
-        current_device->setAnalogGain(
-            DAQ::ChannelType::AI, input_channel, vclamp_ai_gain);
-        current_device->setAnalogZeroOffset(
-            DAQ::ChannelType::AI, input_channel, ai_offset);
-        current_device->setAnalogGain(
-            DAQ::ChannelType::AO, output_channel, vclamp_ao_gain);
-        current_device->setAnalogZeroOffset(
-            DAQ::ChannelType::AO, output_channel, ao_offset);
+  }
+  mark_applied();
+
+  // Without a real-time component the settings are applied from the GUI
+  // thread. Only the settings that differ from the last applied state
+  // reach the device.
+  auto* amp_plugin = dynamic_cast<am_amp2400::Plugin*>(getHostPlugin());
+  const int64_t started = RT::OS::getTime();
+  int64_t last_call = started;
+  local_latency.dispatch.record(started - requested_at);
+  const auto record_setter = [&]()
+  {
+    const int64_t now = RT::OS::getTime();
+    local_latency.setter.record(now - last_call);
+    last_call = now;
+  };
+  for (size_t amp = 0; amp < MAX_AMPLIFIERS; ++amp) {
+    if ((command.transaction.amp_mask & (1U << amp)) != 0) {
+      applied_daq[amp].apply(*current_device,
+                             command.transaction.states[amp],
+                             daq_stats,
+                             record_setter);
+      if (amp_plugin != nullptr) {
+        amp_plugin->getStateLog().append(
+            make_state_entry(last_call,
+                             amp,
+                             state_source::PANEL,
+                             command.transaction.states[amp]));
       }
-      current_device->writeinput(digital_line_0, 0.0);
-      current_device->writeinput(digital_line_1, 0.0);
-      current_device->writeinput(digital_line_2, 0.0);
-      break;
+    }
+  }
+  local_latency.total.record(last_call - requested_at);
+  updateStatsLabel();
+  updateLatencyLabel();
+}
 
-    case amp_mode::IRESIST:  // IResist
-      if (current_device != nullptr) {
-        current_device->setAnalogRange(DAQ::ChannelType::AI, input_channel, 3);
-        current_device->setAnalogGain(
-            DAQ::ChannelType::AI, input_channel, iclamp_ai_gain);
-        current_device->setAnalogZeroOffset(
-            DAQ::ChannelType::AI, input_channel, ai_offset);
-        current_device->setAnalogGain(DAQ::ChannelType::AO,
-                                      output_channel,
-                                      iclamp_ao_gain * probe_gain_factor);
-        current_device->setAnalogZeroOffset(
-            DAQ::ChannelType::AO, output_channel, ao_offset);
-      }
-      current_device->writeinput(digital_line_0, 5.0);
-      current_device->writeinput(digital_line_1, 0.0);
-      current_device->writeinput(digital_line_2, 5.0);
+// Shows p50/p99/max of each stage of the Set DAQ path in microseconds
+void am_amp2400::Panel::updateLatencyLabel()
+{
+  auto* amp_plugin = hostPlugin();
+  const apply_latency& latency =
+      amp_plugin != nullptr ? amp_plugin->getLatency() : local_latency;
+  const auto format = [](const QString& stage, const latency_histogram& hist)
+  {
+    return QString("%1: %2 / %3 / %4\n")
+        .arg(stage)
+        .arg(double(hist.percentile(0.50)) * 1e-3, 0, 'f', 1)
+        .arg(double(hist.percentile(0.99)) * 1e-3, 0, 'f', 1)
+        .arg(double(hist.max()) * 1e-3, 0, 'f', 1);
+  };
+  latencyLabel->setText(
+      QString("Set DAQ latency p50 / p99 / max (us), %1 applies\n")
+          .arg(static_cast<qulonglong>(latency.total.count()))
+      + format("dispatch", latency.dispatch)
+      + format("setter", latency.setter)
+      + format("total", latency.total));
+}
 
-      break;
+void am_amp2400::Panel::updateStatsLabel()
+{
+  daqStatsLabel->setText(QString("DAQ calls: %1 issued, %2 skipped")
+                             .arg(static_cast<qulonglong>(daq_stats.issued))
+                             .arg(static_cast<qulonglong>(daq_stats.skipped)));
+}
 
-    case amp_mode::IFOLLOW:  // IFollow
-      if (current_device != nullptr) {
-        current_device->setAnalogRange(DAQ::ChannelType::AI, input_channel, 3);
-        current_device->setAnalogGain(DAQ::ChannelType::AI,
-                                      input_channel,
-                                      iclamp_ai_gain * probe_gain_factor);
-        current_device->setAnalogZeroOffset(
-            DAQ::ChannelType::AI, input_channel, ai_offset);
-        current_device->setAnalogGain(
-            DAQ::ChannelType::AO, output_channel, iclamp_ao_gain);
-        current_device->setAnalogZeroOffset(
-            DAQ::ChannelType::AO, output_channel, ao_offset);
-      }
+void am_amp2400::Panel::modify()
+{
+  const int64_t requested_at = RT::OS::getTime();
+  storeWidgets();
+  updateDAQ(requested_at, 1U << current_amp);
+  scheduleDirtyRefresh();
+}
 
-      current_device->writeinput(digital_line_0, 0.0);
-      current_device->writeinput(digital_line_1, 5.0);
-      current_device->writeinput(digital_line_2, 5.0);
-      break;
+// Applies every amplifier of the panel in one batched transaction
+void am_amp2400::Panel::applyAll()
+{
+  const int64_t requested_at = RT::OS::getTime();
+  storeWidgets();
+  updateDAQ(requested_at, (1U << amp_count) - 1);
+  scheduleDirtyRefresh();
+}
 
-    default:
-      ERROR_MSG(
-          "ERROR. Something went horribly wrong. The amplifier mode "
-          "is set to an unknown value");
-      break;
-  }
-};
+// Copies the widget values into the configuration of the current amplifier
+void am_amp2400::Panel::storeWidgets()
+{
+  amp_config& config = currentAmp();
+  config.channels.input_channel = static_cast<size_t>(inputBox->value());
+  config.channels.output_channel = static_cast<size_t>(outputBox->value());
+  config.channels.telegraph_lines = {static_cast<size_t>(bit1Box->value()),
+                                     static_cast<size_t>(bit2Box->value()),
+                                     static_cast<size_t>(bit4Box->value())};
+  setProbeGain(probeGainComboBox->currentIndex());
+  config.ai_offset = this->aiOffsetEdit->text().toDouble();
+  config.ao_offset = this->aoOffsetEdit->text().toDouble();
+}
 
-void am_amp2400::Panel::modify()
+// Shows the configuration of the current amplifier in the widgets
+void am_amp2400::Panel::loadWidgets()
 {
-  input_channel = inputBox->text().toInt();
-  output_channel = outputBox->text().toInt();
+  const amp_config& config = currentAmp();
+  const QSignalBlocker input_blocker(inputBox);
+  const QSignalBlocker output_blocker(outputBox);
+  const QSignalBlocker probe_blocker(probeGainComboBox);
+  inputBox->setValue(static_cast<int>(config.channels.input_channel));
+  outputBox->setValue(static_cast<int>(config.channels.output_channel));
+  bit1Box->setValue(static_cast<int>(config.channels.telegraph_lines[0]));
+  bit2Box->setValue(static_cast<int>(config.channels.telegraph_lines[1]));
+  bit4Box->setValue(static_cast<int>(config.channels.telegraph_lines[2]));
+  probeGainComboBox->setCurrentIndex(config.probe_gain);
+  aiOffsetEdit->setText(offset_text(config.ai_offset));
+  aoOffsetEdit->setText(offset_text(config.ao_offset));
+  ampButtonGroup->button(config.mode)->setChecked(true);
+  const mode_settings& settings = settings_for<amp_profile>(config.mode);
+  aiOffsetUnits->setText(QString::fromUtf8(settings.ai_units.data()));
+  aoOffsetUnits->setText(QString::fromUtf8(settings.ao_units.data()));
+  scheduleDirtyRefresh();
+}
 
-  ampButtonGroup->button(mode)->setStyleSheet("QRadioButton { font: normal; }");
-  ampButtonGroup->button(mode)->setStyleSheet("QRadioButton { font: bold;}");
-  const auto probe_gain = probe_gain_t(probeGainComboBox->currentIndex());
-  switch (probe_gain) {
-    case HIGH:
-      probe_gain_factor = 1;  //.10;
-      break;
-    case LOW:
-      probe_gain_factor = 10;  // 1;
-      break;
-    default:
-      ERROR_MSG("ERROR: default called for probe_gain in update(MODIFY)");
-      break;
+// Widget edits only request a refresh. However many arrive while the event
+// loop is busy (e.g. scrolling a spin box), the visuals are updated once.
+void am_amp2400::Panel::scheduleDirtyRefresh()
+{
+  if (dirty_refresh_pending) {
+    return;
   }
+  dirty_refresh_pending = true;
+  QTimer::singleShot(0, this, [this]() { this->refreshDirtyState(); });
+}
 
-  ai_offset = this->aiOffsetEdit->text().toDouble();
-  ao_offset = this->aoOffsetEdit->text().toDouble();
+// Compares the widgets with the configuration last applied to the current
+// amplifier. Widgets only repaint when their state actually changes.
+void am_amp2400::Panel::refreshDirtyState()
+{
+  dirty_refresh_pending = false;
+  const amp_config& applied = applied_amps[current_amp];
+  const auto differs = [](int value, size_t applied_value)
+  { return value < 0 || static_cast<size_t>(value) != applied_value; };
+  inputBox->setDirty(
+      differs(inputBox->value(), applied.channels.input_channel));
+  outputBox->setDirty(
+      differs(outputBox->value(), applied.channels.output_channel));
+  bit1Box->setDirty(
+      differs(bit1Box->value(), applied.channels.telegraph_lines[0]));
+  bit2Box->setDirty(
+      differs(bit2Box->value(), applied.channels.telegraph_lines[1]));
+  bit4Box->setDirty(
+      differs(bit4Box->value(), applied.channels.telegraph_lines[2]));
+  probeGainComboBox->setDirty(probeGainComboBox->currentIndex()
+                              != static_cast<int>(applied.probe_gain));
+  // Fields show offsets in full (offset_text), so the parsed text equals
+  // the applied value exactly unless it was edited
+  const auto offset_differs = [](const QLineEdit* edit, double applied_value)
+  { return edit->text().toDouble() != applied_value; };
+  aiOffsetEdit->setDirty(offset_differs(aiOffsetEdit, applied.ai_offset));
+  aoOffsetEdit->setDirty(offset_differs(aoOffsetEdit, applied.ao_offset));
+  // The applied mode is shown in bold
+  for (auto* button : ampButtonGroup->buttons()) {
+    const bool is_applied = button == ampButtonGroup->button(applied.mode);
+    const QFont& font = is_applied ? applied_mode_font : mode_font;
+    if (button->font() != font) {
+      button->setFont(font);
+    }
+  }
+}
 
-  updateDAQ();
+void am_amp2400::Panel::setAmplifierCount(int count)
+{
+  amp_count = static_cast<size_t>(count);
+  const QSignalBlocker blocker(ampSelectComboBox);
+  while (ampSelectComboBox->count() > count) {
+    ampSelectComboBox->removeItem(ampSelectComboBox->count() - 1);
+  }
+  while (ampSelectComboBox->count() < count) {
+    ampSelectComboBox->addItem(
+        QString("Amp %1").arg(ampSelectComboBox->count() + 1));
+  }
+  if (current_amp >= amp_count) {
+    selectAmplifier(count - 1);
+    ampSelectComboBox->setCurrentIndex(count - 1);
+  }
+}
 
-  // blacken the GUI to reflect that changes have been saved to
-  inputBox->blacken();
-  outputBox->blacken();
-  aiOffsetEdit->blacken();
-  aoOffsetEdit->blacken();
-  probeGainComboBox->blacken();
+void am_amp2400::Panel::selectAmplifier(int index)
+{
+  if (index < 0 || static_cast<size_t>(index) >= amp_count) {
+    return;
+  }
+  storeWidgets();
+  current_amp = static_cast<size_t>(index);
+  loadWidgets();
 }
 
 void am_amp2400::Panel::setAIOffset(const QString& offset)
 {
-  ai_offset = offset.toDouble();
+  currentAmp().ai_offset = offset.toDouble();
 }
 
 void am_amp2400::Panel::setAOOffset(const QString& offset)
 {
-  ao_offset = offset.toDouble();
+  currentAmp().ao_offset = offset.toDouble();
 }
 
 void am_amp2400::Panel::updateOffset(int new_mode)
 {
-  double scaled_ai_offset = ai_offset;
-  double scaled_ao_offset = ao_offset;
-
-  switch (mode) {
-    case VCLAMP:  // VClamp
-    case VCOMP:  // VComp
-    case VTEST:  // VTest
-      scaled_ai_offset = scaled_ai_offset * vclamp_ai_gain;
-      scaled_ao_offset = scaled_ao_offset * vclamp_ao_gain;
-      break;
-    case IEQ0:  // I = 0
-      scaled_ai_offset = scaled_ai_offset * izero_ai_gain;
-      scaled_ao_offset = scaled_ao_offset * izero_ao_gain;
-      break;
-    case ICLAMP:  // IClamp
-    case IRESIST:  // IResist
-    case IFOLLOW:  // IFollow
-      scaled_ai_offset = scaled_ai_offset * iclamp_ai_gain;
-      scaled_ao_offset = scaled_ao_offset * iclamp_ao_gain;
-      break;
-    default:
-      ERROR_MSG(
-          "ERROR. Something went horribly wrong.\n The amplifier mode "
-          "is set to an unknown value");
-      break;
-  }
-
-  switch (new_mode) {
-    case VCLAMP:  // VClamp
-    case VCOMP:  // VComp
-    case VTEST:  // VTest
-      scaled_ai_offset = scaled_ai_offset / vclamp_ai_gain;
-      scaled_ao_offset = scaled_ao_offset / vclamp_ao_gain;
-      aiOffsetUnits->setText("1 mV/pA");
-      aoOffsetUnits->setText("20 mV/V");
-      break;
-    case IEQ0:  // I = 0
-      scaled_ai_offset = scaled_ai_offset / izero_ai_gain;
-      scaled_ao_offset = scaled_ao_offset / izero_ao_gain;
-      aiOffsetUnits->setText("1 V/V");
-      aoOffsetUnits->setText("---");
-      break;
-    case IRESIST:  // IResist
-    case IFOLLOW:  // IFollow
-    case ICLAMP:  // IClamp
-      scaled_ai_offset = scaled_ai_offset / iclamp_ai_gain;
-      scaled_ao_offset = scaled_ao_offset / iclamp_ao_gain;
-      aiOffsetUnits->setText("1 V/V");
-      aoOffsetUnits->setText("2 nA/V");
-      break;
-    default:
-      ERROR_MSG(
-          "ERROR. Something went horribly wrong.\n The amplifier mode "
-          "is set to an unknown value");
-      break;
+  const amp_mode mode = currentAmp().mode;
+  if (!valid_mode(mode) || !valid_mode(new_mode)) {
+    ERROR_MSG(
+        "ERROR. Something went horribly wrong.\n The amplifier mode "
+        "is set to an unknown value");
+    return;
   }
-
-  aiOffsetEdit->setText(QString::number(scaled_ai_offset));
+  const mode_settings& old_settings = settings_for<amp_profile>(mode);
+  const mode_settings& new_settings =
+      settings_for<amp_profile>(amp_mode(new_mode));
+
+  const amp_config& config = currentAmp();
+  const double scaled_ai_offset = config.ai_offset
+      * old_settings.offset_ai_gain / new_settings.offset_ai_gain;
+  const double scaled_ao_offset = config.ao_offset
+      * old_settings.offset_ao_gain / new_settings.offset_ao_gain;
+  aiOffsetUnits->setText(QString::fromUtf8(new_settings.ai_units.data()));
+  aoOffsetUnits->setText(QString::fromUtf8(new_settings.ao_units.data()));
+
+  aiOffsetEdit->setText(offset_text(scaled_ai_offset));
   aiOffsetEdit->setModified(true);
-  aoOffsetEdit->setText(QString::number(scaled_ao_offset));
+  aoOffsetEdit->setText(offset_text(scaled_ao_offset));
   aoOffsetEdit->setModified(true);
 }
 
 void am_amp2400::Panel::updateMode(int value)
 {
-  mode = amp_mode(value);
+  currentAmp().mode = amp_mode(value);
 }
 
 void am_amp2400::Panel::updateOutputChannel(int value)
 {
-  output_channel = value;
+  currentAmp().channels.output_channel = static_cast<size_t>(value);
 }
 
 void am_amp2400::Panel::updateInputChannel(int value)
 {
-  input_channel = value;
+  currentAmp().channels.input_channel = static_cast<size_t>(value);
 }
 
-/*
 void am_amp2400::Panel::findZeroOffset()
 {
-  findZeroButton->setEnabled(false);
-  iclampButton->setEnabled(false);
-  vclampButton->setEnabled(false);
-  izeroButton->setEnabled(false);
-  vcompButton->setEnabled(false);
-  vtestButton->setEnabled(false);
-  iresistButton->setEnabled(false);
-  ifollowButton->setEnabled(false);
-
-  pause(false);
-}
-*/
-
-// It is not clear why this was created. It is not neccessary to calibrate
-// the output signal with the new drivers since it is forcebly set when you
-// write to AO. Analog inputs may be calibrated, but the input analog
-// calibration in previous iterations of this plugin did not actually work! It
-// seems redundant and unused feature. If the user wishes to automatically
-// calibrate input analog channels then perhaps we can implement it here, but
-// for now this is disabled.
-
-/*
-void am_amp2400::Panel::calculateOffset()
-{
-  if (!data_acquired) {
-    std::cout << "Not done yet... " << signal_count << std::endl;
-    return;
-  }
-  checkZeroCalc->stop();
-  pause(true);
-
-  switch (channel) {
-    case AI:
-      zero_offset = zero_signal.mean();
-      std::cout << "AI Calc. Offst. = " << zero_offset * izero_ai_gain
-                << std::endl;
-      std::cout << "AI Curr. Offst. = " << ai_offset << std::endl;
-      std::cout << "AI Total Offst. = "
-                << zero_offset * izero_ai_gain + ai_offset << std::endl;
-      zero_signal.clear();
-
-      aiOffsetEdit->setText(
-          QString::number(zero_offset * izero_ai_gain + ai_offset));
-      aiOffsetEdit->redden();
-      parameter["AI Offset"].edit->setText(
-          QString::number(zero_offset * izero_ai_gain + ai_offset));
-      parameter["AI Offset"].edit->setModified(true);
-
-      channel = AO;
-      data_acquired = false;
-      zero_offset = 0;
-      checkZeroCalc->start();
-      pause(false);
-      break;
+  if (currentAmp().mode != amp_mode::IEQ0) {
+    ERROR_MSG(
+        "am_amp2400::Panel::findZeroOffset : Offsets can only be computed "
+        "with the amplifier in I = 0 mode");
+    return;
+  }
+  rt_command command;
+  command.type = command_t::START_ZERO_CALIBRATION;
+  command.zero_calibration.min_samples = DEFAULT_ZERO_MIN_SAMPLES;
+  command.zero_calibration.max_samples = DEFAULT_ZERO_MAX_SAMPLES;
+  command.zero_calibration.tolerance = zeroToleranceEdit->text().toDouble();
+  if (postCommand(command) != post_result::POSTED) {
+    ERROR_MSG(
+        "am_amp2400::Panel::findZeroOffset : Unable to reach real-time "
+        "component");
+    return;
+  }
+  zero_calibration_amp = current_amp;
+  setZeroCalibrationActive(true);
+}
 
-    case AO:
-      zero_offset = zero_signal.mean();
-      std::cout << "AO Calc. Offst. = " << zero_offset << std::endl;
-      std::cout << "AO Curr. Offst. = " << ao_offset << std::endl;
-      std::cout << "AO Total Offst. = " << ao_offset + zero_offset <<
-std::endl
-                << std::endl;
-      zero_signal.clear();
-
-      aoOffsetEdit->setText(QString::number(ao_offset + zero_offset));
-      aoOffsetEdit->redden();
-      parameter["AO Offset"].edit->setText(
-          QString::number(zero_offset + ao_offset));
-      parameter["AO Offset"].edit->setModified(true);
-
-      findZeroButton->setEnabled(true);
-      iclampButton->setEnabled(true);
-      vclampButton->setEnabled(true);
-      izeroButton->setEnabled(true);
-      vcompButton->setEnabled(true);
-      vtestButton->setEnabled(true);
-      iresistButton->setEnabled(true);
-      ifollowButton->setEnabled(true);
-      modifyButton->setEnabled(true);
-
-      channel = NA;
-      zero_offset = 0;
-      break;
+// Starts the test pulse on the component and a worker that fits every new
+// average. The pulse and the current are in V and A because the DAQ
+// channels carry the VTest gains from the amplifier profile.
+void am_amp2400::Panel::toggleMembraneTest(bool checked)
+{
+  if (!checked) {
+    rt_command command;
+    command.type = command_t::STOP_MEMBRANE_TEST;
+    postCommand(command);
+    stopMembraneWorker();
+    return;
+  }
+  const auto reject = [this](const char* message)
+  {
+    ERROR_MSG("am_amp2400::Panel::toggleMembraneTest : {}", message);
+    const QSignalBlocker blocker(membraneTestButton);
+    membraneTestButton->setChecked(false);
+  };
+  if (applied_amps[current_amp].mode != amp_mode::VTEST) {
+    reject("Apply VTest mode to the amplifier before the membrane test");
+    return;
+  }
+  const double period = double(RT::OS::getPeriod()) * 1e-9;
+  const double pulse_width = membranePulseEdit->text().toDouble() * 1e-3;
+  const auto cycle_samples =
+      static_cast<size_t>(std::llround(2.0 * pulse_width / period));
+  if (cycle_samples < 16 || cycle_samples > MAX_TEST_PULSE_SAMPLES) {
+    reject("Pulse width does not fit the real-time period");
+    return;
+  }
+  const double cycle = double(cycle_samples) * period;
+  rt_command command;
+  command.type = command_t::START_MEMBRANE_TEST;
+  command.membrane_test.cycle_samples = cycle_samples;
+  command.membrane_test.amplitude =
+      membraneAmplitudeEdit->text().toDouble() * 1e-3;
+  command.membrane_test.sweeps_per_average = static_cast<uint64_t>(
+      std::max(1.0, std::floor(MEMBRANE_TEST_RESULT_INTERVAL / cycle)));
+  if (postCommand(command) != post_result::POSTED) {
+    reject("Unable to reach real-time component");
+    return;
+  }
+  stopMembraneWorker();
+  membrane_worker_running = true;
+  membrane_worker = std::thread(&am_amp2400::Panel::analyseMembraneTests,
+                                this,
+                                &hostPlugin()->getMembraneTraces());
+}
 
-    case NA:
-      std::cout << "Case NA isn't supposed to be called." << std::endl;
-      break;
+void am_amp2400::Panel::stopMembraneWorker()
+{
+  if (membrane_worker.joinable()) {
+    membrane_worker_running = false;
+    membrane_worker.join();
+  }
+}
 
-    default:
-      std::cout << "ERROR: default case called." << std::endl;
-      break;
+// Fitting takes far longer than a real-time period, so it runs here on
+// whatever average the component published last.
+void am_amp2400::Panel::analyseMembraneTests(seqlock<membrane_trace>* traces)
+{
+  const auto trace = std::make_unique<membrane_trace>();
+  uint64_t version = 0;
+  traces->read_if_newer(*trace, version);
+  while (membrane_worker_running) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    if (!traces->read_if_newer(*trace, version) || trace->sweeps == 0) {
+      continue;
+    }
+    const membrane_fit fit = fit_membrane_test(*trace);
+    QMetaObject::invokeMethod(
+        this,
+        [this, fit]() { this->showMembraneFit(fit); },
+        Qt::QueuedConnection);
+  }
+}
+
+void am_amp2400::Panel::showMembraneFit(const membrane_fit& fit)
+{
+  if (!fit.seal_valid) {
+    membraneResultLabel->setText("No response");
+    return;
+  }
+  QString text =
+      QString("Rseal: %1 MOhm").arg(fit.seal_resistance * 1e-6, 0, 'f', 1);
+  if (fit.cell_valid) {
+    text += QString("\nRa: %1 MOhm  Rm: %2 MOhm  Cm: %3 pF")
+                .arg(fit.access_resistance * 1e-6, 0, 'f', 1)
+                .arg(fit.membrane_resistance * 1e-6, 0, 'f', 1)
+                .arg(fit.membrane_capacitance * 1e12, 0, 'f', 1);
+  }
+  membraneResultLabel->setText(text);
+}
+
+// Starts a step train on the component. The step is entered in pA and sent
+// in volts of command through the IClamp command scaling.
+void am_amp2400::Panel::balanceBridge()
+{
+  if (applied_amps[current_amp].mode != amp_mode::ICLAMP) {
+    ERROR_MSG(
+        "am_amp2400::Panel::balanceBridge : Apply IClamp mode to the "
+        "amplifier before balancing the bridge");
+    return;
+  }
+  if (membraneTestButton->isChecked()) {
+    membraneTestButton->setChecked(false);
+  }
+  const double period = double(RT::OS::getPeriod()) * 1e-9;
+  const double width = bridgeWidthEdit->text().toDouble() * 1e-3;
+  const auto step_samples =
+      static_cast<size_t>(std::llround(width / period));
+  if (step_samples < 8) {
+    ERROR_MSG(
+        "am_amp2400::Panel::balanceBridge : Step width is too short for "
+        "the real-time period");
+    return;
+  }
+  const double step_current = bridgeStepEdit->text().toDouble() * 1e-12;
+  rt_command command;
+  command.type = command_t::START_BRIDGE_BALANCE;
+  command.bridge_balance.step_samples = step_samples;
+  command.bridge_balance.amplitude =
+      step_current / amp_profile::iclamp_command_current;
+  command.bridge_balance.step_current = step_current;
+  command.bridge_balance.steps =
+      static_cast<uint64_t>(bridgeStepCountBox->value());
+  command.bridge_balance.onset_samples =
+      std::min(step_samples / 4, MAX_BRIDGE_ONSET_SAMPLES);
+  if (postCommand(command) != post_result::POSTED) {
+    ERROR_MSG(
+        "am_amp2400::Panel::balanceBridge : Unable to reach real-time "
+        "component");
+    return;
+  }
+  bridgeBalanceButton->setEnabled(false);
+}
+
+// The component needs the amplifier applied, as it restores that state when
+// the calibration is done
+void am_amp2400::Panel::calibrateLoopback()
+{
+  if (membraneTestButton->isChecked()) {
+    membraneTestButton->setChecked(false);
+  }
+  const double period = double(RT::OS::getPeriod()) * 1e-9;
+  const auto samples = [period](const QLineEdit* edit)
+  {
+    return static_cast<size_t>(
+        std::llround(edit->text().toDouble() * 1e-3 / period));
+  };
+  rt_command command;
+  command.type = command_t::START_LOOPBACK;
+  command.loopback.amp = current_amp;
+  command.loopback.levels = static_cast<uint64_t>(loopbackLevelsBox->value());
+  command.loopback.low = loopbackLowEdit->text().toDouble();
+  command.loopback.high = loopbackHighEdit->text().toDouble();
+  command.loopback.settle_samples = samples(loopbackSettleEdit);
+  command.loopback.average_samples = samples(loopbackAverageEdit);
+  if (postCommand(command) != post_result::POSTED) {
+    ERROR_MSG(
+        "am_amp2400::Panel::calibrateLoopback : Unable to reach real-time "
+        "component");
+    return;
+  }
+  loopbackButton->setEnabled(false);
+  loopbackResultLabel->setText("Calibrating...");
+}
+
+void am_amp2400::Panel::showLoopbackResult(const loopback_report& report)
+{
+  loopbackButton->setEnabled(true);
+  if (!report.fit.valid) {
+    loopbackResultLabel->setText("Failed");
+    logEvent(RT::OS::getTime(),
+             QString("Amp %1 loopback calibration failed. Apply the "
+                     "amplifier first and keep it applied until done")
+                 .arg(static_cast<qulonglong>(report.amp + 1)));
+    return;
+  }
+  const QString result =
+      QString("Gain %1, loop offset %2 mV, linearity %3 mV (%4%)")
+          .arg(report.fit.gain, 0, 'f', 5)
+          .arg(report.fit.loop_offset * 1e3, 0, 'f', 3)
+          .arg(report.fit.linearity_error * 1e3, 0, 'f', 3)
+          .arg(report.fit.relative_linearity_error * 1e2, 0, 'f', 3);
+  loopbackResultLabel->setText(result);
+  const int64_t now = RT::OS::getTime();
+  logEvent(now,
+           QString("Amp %1 loopback AO %2 -> AI %3 (range %4): %5")
+               .arg(static_cast<qulonglong>(report.amp + 1))
+               .arg(static_cast<qulonglong>(report.output_channel))
+               .arg(static_cast<qulonglong>(report.input_channel))
+               .arg(static_cast<qulonglong>(report.ai_range))
+               .arg(result));
+  // Measured at unity gain and zero offset, so the intercept is the AO
+  // offset plus the AI offset at this range. It is stored as that combined
+  // loop correction, keyed by both channels.
+  calibrations.store(report.device->getName(),
+                     report.input_channel,
+                     report.output_channel,
+                     report.ai_range,
+                     report.fit.loop_offset,
+                     now);
+  if (!calibrations.save(calibrationPath())) {
+    ERROR_MSG("am_amp2400::Panel::showLoopbackResult : Unable to write {}",
+              calibrationPath());
+  }
+}
+
+void am_amp2400::Panel::forgetCalibration()
+{
+  if (current_device == nullptr) {
+    return;
+  }
+  const amp_config& config = currentAmp();
+  const size_t range = settings_for<amp_profile>(config.mode).ai_range;
+  calibrations.clear(current_device->getName(),
+                     config.channels.input_channel,
+                     config.channels.output_channel,
+                     range);
+  if (!calibrations.save(calibrationPath())) {
+    ERROR_MSG("am_amp2400::Panel::forgetCalibration : Unable to write {}",
+              calibrationPath());
+  }
+  logEvent(RT::OS::getTime(),
+           QString("Stored loop offset of AO %1 -> AI %2 at range %3 dropped")
+               .arg(static_cast<qulonglong>(config.channels.output_channel))
+               .arg(static_cast<qulonglong>(config.channels.input_channel))
+               .arg(static_cast<qulonglong>(range)));
+}
+
+// The DAQ settings for a configuration. Each AI range has its own offset,
+// so the loop offset stored for the amplifier's channels at the range the
+// mode uses is added to its AI offset. It was measured in volts at unity
+// gain, so like the zero offsets it is scaled by the AI gain of the mode.
+// A loopback cannot tell the AO part of that offset from the AI part, so
+// both are corrected on the input.
+am_amp2400::daq_state am_amp2400::Panel::resolveState(
+    const amp_config& config) const
+{
+  daq_state state = make_daq_state<amp_profile>(config);
+  if (current_device == nullptr || !calibrationBox->isChecked()) {
+    return state;
+  }
+  const calibration_record* record =
+      calibrations.find(current_device->getName(),
+                        state.input_channel,
+                        state.output_channel,
+                        state.ai_range);
+  if (record != nullptr) {
+    state.ai_offset += record->loop_offset * state.ai_gain;
+  }
+  return state;
+}
+
+std::string am_amp2400::Panel::calibrationPath()
+{
+  const QDir directory(
+      QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation));
+  directory.mkpath(".");
+  return directory.filePath("am-amp2400-calibration.bin").toStdString();
+}
+
+void am_amp2400::Panel::updateBridgeCorrection()
+{
+  rt_command command;
+  command.type = command_t::SET_BRIDGE_CORRECTION;
+  command.bridge_correction.enabled = bridgeCorrectionBox->isChecked();
+  command.bridge_correction.resistance =
+      bridgeResistanceEdit->text().toDouble() * 1e6;
+  postCommand(command);
+}
+
+// Sends a command to the real-time component, starting it if needed
+am_amp2400::post_result am_amp2400::Panel::postCommand(
+    const rt_command& command)
+{
+  auto* amp_plugin = hostPlugin();
+  if (amp_plugin == nullptr) {
+    return post_result::NO_COMPONENT;
+  }
+  if (!amp_plugin->getCommands().try_push(command)) {
+    return post_result::QUEUE_FULL;
+  }
+  if (!amp_plugin->getActive()) {
+    amp_plugin->setActive(true);
+  }
+  return post_result::POSTED;
+}
+
+// Sends the drift tracking settings to the component. The amplifier being
+// edited when tracking is switched on is the one tracked.
+void am_amp2400::Panel::updateDriftTracking()
+{
+  const double period = double(RT::OS::getPeriod()) * 1e-9;
+  const double time_constant = driftTimeConstantEdit->text().toDouble();
+  rt_command command;
+  command.type = command_t::SET_DRIFT_TRACKING;
+  command.drift_tracking.enabled = driftGroupBox->isChecked();
+  command.drift_tracking.amp = current_amp;
+  command.drift_tracking.smoothing_factor =
+      time_constant > period ? period / time_constant : 1.0;
+  command.drift_tracking.threshold = driftThresholdEdit->text().toDouble();
+  if (postCommand(command) != post_result::POSTED
+      && command.drift_tracking.enabled)
+  {
+    ERROR_MSG(
+        "am_amp2400::Panel::updateDriftTracking : Unable to reach real-time "
+        "component");
+  }
+}
+
+// Hands the ranges of the AI channel of the amplifier being edited to the
+// component, widest first, along with the loop offset stored for each
+void am_amp2400::Panel::updateAutoRange()
+{
+  rt_command command;
+  command.type = command_t::SET_AUTO_RANGE;
+  command.auto_range = auto_range_request {};
+  command.auto_range.enabled = autoRangeGroupBox->isChecked();
+  if (command.auto_range.enabled) {
+    const size_t channel = currentAmp().channels.input_channel;
+    std::vector<std::pair<double, size_t>> ranges;
+    const size_t range_count = current_device == nullptr
+        ? 0
+        : current_device->getAnalogRangeCount(DAQ::ChannelType::AI, channel);
+    for (size_t range = 0; range < range_count; ++range) {
+      const double full_scale =
+          range_full_scale(current_device->getAnalogRangeString(
+              DAQ::ChannelType::AI, channel, range));
+      if (full_scale > 0.0) {
+        ranges.emplace_back(full_scale, range);
+      }
+    }
+    if (ranges.size() < 2) {
+      ERROR_MSG(
+          "am_amp2400::Panel::updateAutoRange : AI {} needs a DAQ device with "
+          "at least two input ranges",
+          channel);
+      // Unchecking posts the disabled request
+      autoRangeGroupBox->setChecked(false);
+      return;
+    }
+    std::sort(ranges.begin(),
+              ranges.end(),
+              [](const auto& first, const auto& second)
+              { return first.first > second.first; });
+    ranges.resize(std::min(ranges.size(), MAX_AUTO_RANGES));
+    command.auto_range.amp = current_amp;
+    command.auto_range.input_channel = channel;
+    command.auto_range.range_count = ranges.size();
+    for (size_t level = 0; level < ranges.size(); ++level) {
+      command.auto_range.full_scales[level] = ranges[level].first;
+      command.auto_range.ranges[level] = ranges[level].second;
+      const calibration_record* record = calibrationBox->isChecked()
+          ? calibrations.find(current_device->getName(),
+                              channel,
+                              currentAmp().channels.output_channel,
+                              ranges[level].second)
+          : nullptr;
+      command.auto_range.offsets[level] =
+          record != nullptr ? record->loop_offset : 0.0;
+    }
+  }
+  const double period = double(RT::OS::getPeriod()) * 1e-9;
+  const double hold = autoRangeHoldEdit->text().toDouble() * 1e-3;
+  command.auto_range.hold_blocks = static_cast<uint64_t>(std::max(
+      1.0, std::ceil(hold / period / double(AUTO_RANGE_BLOCK_SIZE))));
+  // The sample read after the change is the first on the new range, so it
+  // is always flagged
+  const double flag = autoRangeFlagEdit->text().toDouble() * 1e-3;
+  command.auto_range.flag_samples =
+      2 + static_cast<size_t>(std::llround(flag / period));
+  if (postCommand(command) != post_result::POSTED
+      && command.auto_range.enabled)
+  {
+    ERROR_MSG(
+        "am_amp2400::Panel::updateAutoRange : Unable to reach real-time "
+        "component");
+  }
+}
+
+void am_amp2400::Panel::updateFilter()
+{
+  rt_command command;
+  command.type = command_t::SET_FILTER;
+  command.filter.enabled = filterGroupBox->isChecked();
+  command.filter.line_frequency =
+      filterLineComboBox->currentText().toDouble();
+  command.filter.harmonics = static_cast<size_t>(filterHarmonicsBox->value());
+  command.filter.notch_q = filterNotchQEdit->text().toDouble();
+  command.filter.lowpass_cutoff = filterLowpassEdit->text().toDouble();
+  if (postCommand(command) != post_result::POSTED
+      && command.filter.enabled)
+  {
+    ERROR_MSG(
+        "am_amp2400::Panel::updateFilter : Unable to reach real-time "
+        "component");
+  }
+}
+
+// Queues the configuration of the amplifier being edited on the component,
+// to be committed delay milliseconds from now rounded to whole periods
+void am_amp2400::Panel::scheduleSwitch()
+{
+  auto* amp_plugin = hostPlugin();
+  if (amp_plugin == nullptr || current_device == nullptr) {
+    ERROR_MSG(
+        "am_amp2400::Panel::scheduleSwitch : Scheduling needs a DAQ device "
+        "and the real-time component");
+    return;
+  }
+  storeWidgets();
+  const double period = double(RT::OS::getPeriod());
+  const double delay = scheduleDelayEdit->text().toDouble() * 1e6;
+  const auto delay_ticks = static_cast<uint64_t>(std::llround(delay / period));
+
+  rt_command command;
+  command.type = command_t::SCHEDULE_TRANSACTION;
+  command.scheduled.tick = amp_plugin->getTick() + delay_ticks;
+  command.scheduled.transaction.device = current_device;
+  command.scheduled.transaction.amp_mask = 1U << current_amp;
+  command.scheduled.transaction.requested_at = RT::OS::getTime();
+  command.scheduled.transaction.states[current_amp] =
+      resolveState(currentAmp());
+  if (postCommand(command) != post_result::POSTED) {
+    ERROR_MSG(
+        "am_amp2400::Panel::scheduleSwitch : Unable to reach real-time "
+        "component");
+    return;
+  }
+  logEvent(command.scheduled.transaction.requested_at,
+           QString("Amp %1 switch scheduled for tick %2")
+               .arg(static_cast<qulonglong>(current_amp + 1))
+               .arg(static_cast<qulonglong>(command.scheduled.tick)));
+}
+
+void am_amp2400::Panel::clearSchedule()
+{
+  rt_command command;
+  command.type = command_t::CLEAR_SCHEDULE;
+  postCommand(command);
+}
+
+std::string am_amp2400::Panel::presetPath()
+{
+  const QDir directory(
+      QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation));
+  directory.mkpath(".");
+  return directory.filePath("am-amp2400-presets.bin").toStdString();
+}
+
+void am_amp2400::Panel::refreshPresetNames()
+{
+  const QSignalBlocker blocker(presetComboBox);
+  const int selected = std::max(presetComboBox->currentIndex(), 0);
+  presetComboBox->clear();
+  for (size_t slot = 0; slot < NUM_PRESETS; ++slot) {
+    const QString name = presets.used(slot)
+        ? QString::fromStdString(presets.name(slot))
+        : QString("(empty)");
+    presetComboBox->addItem(
+        QString("Ctrl+%1: %2").arg(static_cast<int>(slot + 1)).arg(name));
+  }
+  presetComboBox->setCurrentIndex(selected);
+}
+
+void am_amp2400::Panel::savePreset()
+{
+  const auto slot = static_cast<size_t>(presetComboBox->currentIndex());
+  const QString current_name = presets.used(slot)
+      ? QString::fromStdString(presets.name(slot))
+      : QString("Preset %1").arg(static_cast<int>(slot + 1));
+  bool accepted = false;
+  const QString name = QInputDialog::getText(this,
+                                             "Save Preset",
+                                             "Preset name:",
+                                             QLineEdit::Normal,
+                                             current_name,
+                                             &accepted);
+  if (!accepted) {
+    return;
+  }
+  storeWidgets();
+  presets.store(slot, name.trimmed().toStdString(), currentAmp());
+  if (!presets.save(presetPath())) {
+    ERROR_MSG("am_amp2400::Panel::savePreset : Unable to write {}",
+              presetPath());
+  }
+  refreshPresetNames();
+}
+
+void am_amp2400::Panel::recallSelectedPreset()
+{
+  recallPreset(static_cast<size_t>(presetComboBox->currentIndex()));
+}
+
+void am_amp2400::Panel::clearPreset()
+{
+  presets.clear(static_cast<size_t>(presetComboBox->currentIndex()));
+  if (!presets.save(presetPath())) {
+    ERROR_MSG("am_amp2400::Panel::clearPreset : Unable to write {}",
+              presetPath());
+  }
+  refreshPresetNames();
+}
+
+// Replaces the amplifier being edited with a preset and applies it at once.
+// Everything needed is already in memory, so this is as fast as Set DAQ.
+void am_amp2400::Panel::recallPreset(size_t slot)
+{
+  if (slot >= NUM_PRESETS || !presets.used(slot)) {
+    return;
+  }
+  const int64_t requested_at = RT::OS::getTime();
+  currentAmp() = presets.config(slot);
+  loadWidgets();
+  updateDAQ(requested_at, 1U << current_amp);
+  {
+    const QSignalBlocker blocker(presetComboBox);
+    presetComboBox->setCurrentIndex(static_cast<int>(slot));
+  }
+  logEvent(requested_at,
+           QString("Amp %1 recalled preset %2")
+               .arg(static_cast<qulonglong>(current_amp + 1))
+               .arg(QString::fromStdString(presets.name(slot))));
+}
+
+std::string am_amp2400::Panel::controlSocketPath()
+{
+  const QString directory =
+      QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+  return QDir(directory).filePath("am-amp2400.sock").toStdString();
+}
+
+void am_amp2400::Panel::toggleControlSocket(bool checked)
+{
+  if (!checked) {
+    control.stop();
+    return;
+  }
+  // Requests are executed on the GUI thread, like a click on the panel, and
+  // answered from there
+  const std::string error = control.start(
+      controlSocketPath(),
+      [this](uint64_t client, const std::string& request)
+      {
+        QMetaObject::invokeMethod(
+            this,
+            [this, client, request]()
+            { control.reply(client, this->executeControl(request)); },
+            Qt::QueuedConnection);
+      });
+  if (!error.empty()) {
+    ERROR_MSG(
+        "am_amp2400::Panel::toggleControlSocket : Unable to listen on {}: {}",
+        controlSocketPath(),
+        error);
+    const QSignalBlocker blocker(controlSocketBox);
+    controlSocketBox->setChecked(false);
+    return;
+  }
+  logEvent(RT::OS::getTime(),
+           QString("Listening on %1")
+               .arg(QString::fromStdString(controlSocketPath())));
+}
+
+// Runs one request line from the control socket (see run_commands), on the
+// amplifier shown in the panel unless the request picks another. The whole
+// request is checked before anything changes. "apply" hands every amplifier
+// the request touched to the DAQ in one transaction. The reply starts with
+// "ok" or "error" and the real-time clock in ns, followed by the resulting
+// state of the touched amplifiers.
+std::string am_amp2400::Panel::executeControl(const std::string& request)
+{
+  // The widgets always show the amplifier at current_amp
+  storeWidgets();
+  command_batch batch {amps, current_amp, 0, false, false};
+  std::string error = run_commands(request, commandLimits(), batch);
+  if (error.empty() && batch.edited && zero_calibration_running) {
+    error = "zero calibration running";
+  } else if (error.empty() && batch.apply && current_device == nullptr) {
+    error = "apply: no DAQ device selected";
+  }
+  const int64_t requested_at = RT::OS::getTime();
+  if (!error.empty()) {
+    return "error " + std::to_string(requested_at) + " " + error + "\n";
+  }
+
+  amps = batch.amps;
+  if ((batch.touched & (1U << current_amp)) != 0) {
+    loadWidgets();
+  }
+  if (batch.apply) {
+    updateDAQ(requested_at, batch.touched);
+  }
+  scheduleDirtyRefresh();
+  std::string reply = "ok " + std::to_string(RT::OS::getTime());
+  const char* separator = " ";
+  for (size_t amp = 0; amp < amp_count; ++amp) {
+    if ((batch.touched & (1U << amp)) != 0) {
+      reply += separator;
+      reply += describe_amp(amp, amps[amp], amps[amp] == applied_amps[amp]);
+      separator = "; ";
+    }
+  }
+  return reply + "\n";
+}
+
+// Bounds of the text commands, as allowed by the widgets
+am_amp2400::command_limits am_amp2400::Panel::commandLimits() const
+{
+  return {amp_count,
+          static_cast<size_t>(inputBox->maximum()),
+          static_cast<size_t>(bit1Box->maximum())};
+}
+
+// Parses a protocol file against the current configuration and hands the
+// compiled steps to the component. The file is not read again while the
+// protocol runs.
+void am_amp2400::Panel::runProtocol()
+{
+  auto* amp_plugin = hostPlugin();
+  if (protocol_running || amp_plugin == nullptr || current_device == nullptr
+      || zero_calibration_running)
+  {
+    ERROR_MSG(
+        "am_amp2400::Panel::runProtocol : Protocols need a DAQ device and "
+        "the real-time component, and cannot run during zero calibration");
+    return;
+  }
+  const QString path = QFileDialog::getOpenFileName(
+      this, "Run Protocol", QString(), "Protocols (*.txt);;All files (*)");
+  if (path.isEmpty()) {
+    return;
+  }
+  std::ifstream file(path.toStdString());
+  storeWidgets();
+  const std::string error =
+      file ? parse_protocol(
+                 file, amps, current_amp, commandLimits(), protocol_entries)
+           : std::string("unable to read the file");
+  if (!error.empty()) {
+    ERROR_MSG("am_amp2400::Panel::runProtocol : {}: {}",
+              path.toStdString(),
+              error);
+    protocolStatusLabel->setText(QString::fromStdString(error));
+    return;
+  }
+
+  // Only resized here, while the component holds no pointer into it
+  const double period = double(RT::OS::getPeriod());
+  const int64_t requested_at = RT::OS::getTime();
+  std::vector<protocol_step>& steps = amp_plugin->getProtocolSteps();
+  steps.assign(protocol_entries.size(), protocol_step {});
+  for (size_t index = 0; index < steps.size(); ++index) {
+    const protocol_entry& entry = protocol_entries[index];
+    mode_transaction& transaction = steps[index].transaction;
+    transaction.device = current_device;
+    transaction.amp_mask = entry.amp_mask;
+    transaction.requested_at = requested_at;
+    for (size_t amp = 0; amp < MAX_AMPLIFIERS; ++amp) {
+      if ((entry.amp_mask & (1U << amp)) != 0) {
+        transaction.states[amp] = resolveState(entry.amps[amp]);
+      }
+    }
+    steps[index].duration_ticks = std::max<uint64_t>(
+        1, static_cast<uint64_t>(std::llround(entry.duration * 1e9 / period)));
+  }
+  rt_command command;
+  command.type = command_t::START_PROTOCOL;
+  command.protocol = {steps.data(), steps.size()};
+  if (postCommand(command) != post_result::POSTED) {
+    ERROR_MSG(
+        "am_amp2400::Panel::runProtocol : Unable to reach real-time "
+        "component");
+    return;
+  }
+  protocol_running = true;
+  protocolRunButton->setEnabled(false);
+  protocolStopButton->setEnabled(true);
+  logEvent(requested_at,
+           QString("Protocol %1 started, %2 steps")
+               .arg(path)
+               .arg(static_cast<qulonglong>(steps.size())));
+}
+
+void am_amp2400::Panel::stopProtocol()
+{
+  rt_command command;
+  command.type = command_t::STOP_PROTOCOL;
+  postCommand(command);
+}
+
+// The component applies the steps on its own, so the panel follows along
+// the same way it follows drift corrections
+void am_amp2400::Panel::showProtocolProgress(const protocol_progress& progress)
+{
+  const size_t count = protocol_entries.size();
+  if (progress.finished) {
+    protocol_running = false;
+    protocolRunButton->setEnabled(true);
+    protocolStopButton->setEnabled(false);
+    const QString message = progress.step == count
+        ? QString("Protocol finished")
+        : QString("Protocol stopped during step %1")
+              .arg(static_cast<qulonglong>(progress.step));
+    protocolStatusLabel->setText(message);
+    logEvent(progress.time, message);
+    return;
+  }
+  if (progress.step >= count) {
+    return;
+  }
+  const protocol_entry& entry = protocol_entries[progress.step];
+  for (size_t amp = 0; amp < MAX_AMPLIFIERS; ++amp) {
+    if ((entry.amp_mask & (1U << amp)) != 0) {
+      amps[amp] = entry.amps[amp];
+      applied_amps[amp] = entry.amps[amp];
+    }
   }
-}*/
+  if ((entry.amp_mask & (1U << current_amp)) != 0) {
+    loadWidgets();
+  }
+  scheduleDirtyRefresh();
+  const QString message = QString("Protocol step %1/%2: %3 (%4 s)")
+                              .arg(static_cast<qulonglong>(progress.step + 1))
+                              .arg(static_cast<qulonglong>(count))
+                              .arg(QString::fromStdString(entry.name))
+                              .arg(entry.duration);
+  protocolStatusLabel->setText(message);
+  logEvent(progress.time, message);
+}
+
+void am_amp2400::Panel::updateWatchdog()
+{
+  watchdog_mismatches.fill(0);
+  watchdog_warned = 0;
+  if (!watchdogGroupBox->isChecked()) {
+    watchdogTimer->stop();
+    return;
+  }
+  const double interval =
+      std::max(watchdogIntervalEdit->text().toDouble(), 0.1);
+  watchdogTimer->start(static_cast<int>(std::lround(interval * 1e3)));
+}
+
+// Reads back the channels of one amplifier per timeout, so a check costs
+// five getter calls however many amplifiers the panel drives
+void am_amp2400::Panel::checkWatchdog()
+{
+  if (current_device == nullptr) {
+    return;
+  }
+  const size_t amp = watchdog_amp % amp_count;
+  watchdog_amp = (amp + 1) % amp_count;
+  daq_state state {};
+  if (!appliedState(amp, state)) {
+    watchdog_mismatches[amp] = 0;
+    return;
+  }
+  const uint32_t mismatches = find_mismatches(*current_device, state);
+  const uint32_t previous =
+      std::exchange(watchdog_mismatches[amp], mismatches);
+  const uint32_t amp_bit = 1U << amp;
+  if (mismatches == 0) {
+    watchdog_warned &= ~amp_bit;
+    return;
+  }
+  if (mismatches != previous) {
+    return;
+  }
+  const QString settings =
+      QString::fromStdString(describe_settings(mismatches));
+  if (watchdogRepairBox->isChecked()) {
+    reapplyState(amp);
+    watchdog_mismatches[amp] = 0;
+    logEvent(RT::OS::getTime(),
+             QString("Amp %1 %2 changed outside the panel, re-applied")
+                 .arg(static_cast<qulonglong>(amp + 1))
+                 .arg(settings));
+    return;
+  }
+  if ((watchdog_warned & amp_bit) == 0) {
+    watchdog_warned |= amp_bit;
+    ERROR_MSG(
+        "am_amp2400::Panel::checkWatchdog : Amp {} {} no longer match the "
+        "applied state",
+        amp + 1,
+        settings.toStdString());
+    logEvent(RT::OS::getTime(),
+             QString("Amp %1 %2 changed outside the panel, data is scaled "
+                     "wrong until Set DAQ")
+                 .arg(static_cast<qulonglong>(amp + 1))
+                 .arg(settings));
+  }
+}
+
+// What the device should hold for amp. After an apply without the
+// real-time component the panel's own shadows know it, otherwise the
+// component's do.
+bool am_amp2400::Panel::appliedState(size_t amp, daq_state& state)
+{
+  if (applied_daq[amp].valid()) {
+    state = applied_daq[amp].state();
+    return true;
+  }
+  auto* amp_plugin = hostPlugin();
+  if (amp_plugin == nullptr) {
+    return false;
+  }
+  applied_snapshot snapshot {};
+  uint64_t version = 0;
+  if (!amp_plugin->getAppliedStates().read_if_newer(snapshot, version)
+      || snapshot.device != current_device
+      || (snapshot.valid_mask & (1U << amp)) == 0)
+  {
+    return false;
+  }
+  state = snapshot.states[amp];
+  return true;
+}
+
+void am_amp2400::Panel::reapplyState(size_t amp)
+{
+  if (!applied_daq[amp].valid()) {
+    rt_command command;
+    command.type = command_t::REAPPLY_STATE;
+    command.reapply.amp_mask = 1U << amp;
+    postCommand(command);
+    return;
+  }
+  const daq_state state = applied_daq[amp].state();
+  applied_daq[amp].invalidate();
+  applied_daq[amp].apply(*current_device, state, daq_stats);
+  auto* amp_plugin = dynamic_cast<am_amp2400::Plugin*>(getHostPlugin());
+  if (amp_plugin != nullptr) {
+    amp_plugin->getStateLog().append(make_state_entry(
+        RT::OS::getTime(), amp, state_source::WATCHDOG, state));
+  }
+  updateStatsLabel();
+}
+
+// Appends a line to the event log, stamped with the real-time clock
+void am_amp2400::Panel::logEvent(int64_t time, const QString& message)
+{
+  eventLog->appendPlainText(
+      QString("[%1 s] %2").arg(double(time) * 1e-9, 0, 'f', 3).arg(message));
+}
+
+// Mode and button changes are locked out while the component is averaging,
+// otherwise the offsets would be computed for the wrong mode.
+void am_amp2400::Panel::setZeroCalibrationActive(bool active)
+{
+  zero_calibration_running = active;
+  findZeroButton->setEnabled(!active);
+  ampSelectComboBox->setEnabled(!active);
+  ampCountBox->setEnabled(!active);
+  iclampButton->setEnabled(!active);
+  vclampButton->setEnabled(!active);
+  izeroButton->setEnabled(!active);
+  vcompButton->setEnabled(!active);
+  vtestButton->setEnabled(!active);
+  iresistButton->setEnabled(!active);
+  ifollowButton->setEnabled(!active);
+}
 
 std::unique_ptr<Widgets::Plugin> createRTXIPlugin(Event::Manager* ev_manager)
 {
@@ -677,7 +2911,7 @@ Widgets::Panel* createRTXIPanel(QMainWindow* main_window,
 std::unique_ptr<Widgets::Component> createRTXIComponent(
     Widgets::Plugin* host_plugin)
 {
-  return nullptr;
+  return std::make_unique<am_amp2400::Component>(host_plugin);
 }
 
 Widgets::FactoryMethods fact;
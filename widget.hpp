@@ -1,12 +1,41 @@
-
+#include <QCheckBox>
 #include <QComboBox>
+#include <QFont>
+#include <QGroupBox>
+#include <QPalette>
+#include <QPlainTextEdit>
+#include <QPushButton>
 #include <QRadioButton>
 #include <QSpinBox>
+#include <QTimer>
+#include <atomic>
+#include <memory>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
-#include <rtxi/math/runningstat.h>
+#include <rtxi/fifo.hpp>
 #include <rtxi/widgets.hpp>
 
+#include "amp_commands.hpp"
+#include "amp_math.hpp"
+#include "amp_profile.hpp"
+#include "auto_range.hpp"
+#include "bridge_balance.hpp"
+#include "calibration_cache.hpp"
+#include "control_server.hpp"
+#include "daq_state.hpp"
+#include "latency.hpp"
+#include "loopback.hpp"
+#include "line_filter.hpp"
+#include "lockfree.hpp"
+#include "membrane_test.hpp"
+#include "preset_bank.hpp"
+#include "protocol.hpp"
+#include "state_log.hpp"
+#include "tick_queue.hpp"
+
 namespace DAQ
 {
 class Device;
@@ -19,6 +48,39 @@ namespace am_amp2400
 
 constexpr std::string_view MODULE_NAME = "am-amp2400";
 
+enum INPUT_CHANNEL : size_t
+{
+  AI_ZERO_INPUT = 0,
+  AO_ZERO_INPUT,
+  AMPLIFIER_SIGNAL_INPUT,
+  CURRENT_COMMAND_INPUT
+};
+
+enum OUTPUT_CHANNEL : size_t
+{
+  TEST_PULSE_OUTPUT = 0,
+  BRIDGE_CORRECTED_OUTPUT,
+  RANGE_CHANGE_OUTPUT,
+  FILTERED_OUTPUT,
+  FIRST_STATE_OUTPUT
+};
+
+// Outputs describing the state applied to each amplifier. They follow
+// FIRST_STATE_OUTPUT, one group per amplifier.
+enum STATE_OUTPUT : size_t
+{
+  MODE_OUTPUT = 0,
+  AI_SCALE_OUTPUT,
+  AO_SCALE_OUTPUT,
+  PROBE_GAIN_OUTPUT,
+  NUM_STATE_OUTPUTS
+};
+
+constexpr size_t state_output(size_t amp, STATE_OUTPUT output)
+{
+  return FIRST_STATE_OUTPUT + amp * NUM_STATE_OUTPUTS + output;
+}
+
 inline std::vector<Widgets::Variable::Info> get_default_vars()
 {
   return {};
@@ -26,15 +88,359 @@ inline std::vector<Widgets::Variable::Info> get_default_vars()
 
 inline std::vector<IO::channel_t> get_default_channels()
 {
-  return {};
+  std::vector<IO::channel_t> channels = {{"I=0 Input from AI",
+           "Empty signal from analog input for 'calibrating' the input "
+           "channel for I=0.",
+           IO::INPUT},
+          {"I=0 Input from AO",
+           "Empty signal from analog output for 'calibrating' the output "
+           "channel for I=0.",
+           IO::INPUT},
+          {"Amplifier Signal",
+           "Analog input from the amplifier: current in VTest (A), "
+           "potential in IClamp (V).",
+           IO::INPUT},
+          {"Current Command",
+           "Command sent to the analog output in IClamp, used for the "
+           "bridge correction (V of command).",
+           IO::INPUT},
+          {"Test Pulse",
+           "Test pulses of the membrane test (VTest) and bridge balance "
+           "(IClamp), to be added to the analog output command.",
+           IO::OUTPUT},
+          {"Bridge Corrected Potential",
+           "Amplifier Signal minus the drop across the balanced access "
+           "resistance (V).",
+           IO::OUTPUT},
+          {"AI Range Change",
+           "1 on the samples around an automatic change of the analog "
+           "input range, 0 otherwise.",
+           IO::OUTPUT},
+          {"Filtered Signal",
+           "Amplifier Signal with the line noise notched out and low-pass "
+           "filtered, 0 while the filter is off.",
+           IO::OUTPUT}};
+  // Written whenever a state is applied and held in between, so that other
+  // modules (e.g. the data recorder) can tag samples with the active state
+  for (size_t amp = 1; amp <= MAX_AMPLIFIERS; ++amp) {
+    const std::string prefix = "Amp " + std::to_string(amp);
+    channels.push_back({prefix + " Mode",
+                        "Applied amp_mode (0 VClamp, 1 I=0, 2 IClamp, "
+                        "3 VComp, 4 VTest, 5 IResist, 6 IFollow, 7 none).",
+                        IO::OUTPUT});
+    channels.push_back({prefix + " AI Scale",
+                        "Gain applied to the analog input, including the "
+                        "probe gain factor where it applies.",
+                        IO::OUTPUT});
+    channels.push_back({prefix + " AO Scale",
+                        "Gain applied to the analog output, including the "
+                        "probe gain factor where it applies.",
+                        IO::OUTPUT});
+    channels.push_back({prefix + " Probe Gain Factor",
+                        "Probe gain factor of the applied state.",
+                        IO::OUTPUT});
+  }
+  return channels;
 }
 
-enum probe_gain_t : std::uint8_t
+// Bounds on the number of samples averaged by the real-time component when
+// computing the I=0 offsets. The averaging stops in between as soon as the
+// standard error of both means is below the requested tolerance. The upper
+// bound is the fixed count used by the legacy plugin.
+constexpr uint64_t DEFAULT_ZERO_MIN_SAMPLES = 200;
+constexpr uint64_t DEFAULT_ZERO_MAX_SAMPLES = 5000;
+constexpr double DEFAULT_ZERO_TOLERANCE = 1e-4;  // volts
+
+// Cycles averaged into each membrane test result are chosen so that a
+// result is ready about this often.
+constexpr double MEMBRANE_TEST_RESULT_INTERVAL = 0.2;  // seconds
+
+// Size in bytes of the fifo carrying reports from the real-time component
+// back to the panel.
+constexpr size_t FIFO_CAPACITY = 4096;
+
+// Number of commands the panel can queue before the component drains them
+constexpr size_t COMMAND_RING_CAPACITY = 64;
+
+// Messages sent from the panel to the real-time component. They are plain
+// structs so that they can be copied through the command ring without
+// allocating on either side.
+enum class command_t : uint8_t
+{
+  START_ZERO_CALIBRATION = 0,
+  CANCEL_ZERO_CALIBRATION,
+  APPLY_TRANSACTION,
+  SET_DRIFT_TRACKING,
+  SCHEDULE_TRANSACTION,
+  CLEAR_SCHEDULE,
+  START_MEMBRANE_TEST,
+  STOP_MEMBRANE_TEST,
+  START_BRIDGE_BALANCE,
+  SET_BRIDGE_CORRECTION,
+  START_PROTOCOL,
+  STOP_PROTOCOL,
+  REAPPLY_STATE,
+  START_LOOPBACK,
+  SET_AUTO_RANGE,
+  SET_FILTER
+};
+
+// Number of mode changes the component can hold for later ticks
+constexpr size_t MAX_SCHEDULED_TRANSACTIONS = 32;
+
+// A complete mode change for one or more amplifiers. The component commits
+// all of it within a single real-time period so that no sample sees a mix of
+// old and new settings.
+struct mode_transaction
+{
+  DAQ::Device* device;
+  std::array<daq_state, MAX_AMPLIFIERS> states;
+  // Bit i is set when states[i] is part of the transaction
+  uint32_t amp_mask;
+  // RT::OS::getTime() when Set DAQ was pressed
+  int64_t requested_at;
+};
+
+struct zero_calibration_request
+{
+  uint64_t min_samples;
+  uint64_t max_samples;
+  // Largest acceptable standard error of the mean
+  double tolerance;
+};
+
+// Background correction of the AI offset while an amplifier sits in I=0
+struct drift_tracking_request
+{
+  bool enabled;
+  size_t amp;
+  // Period divided by the baseline time constant
+  double smoothing_factor;
+  // Drift of the I=0 input (V) that triggers a correction
+  double threshold;
+};
+
+struct membrane_test_request
+{
+  // Samples per pulse plus holding cycle
+  size_t cycle_samples;
+  // Pulse amplitude relative to holding (V)
+  double amplitude;
+  uint64_t sweeps_per_average;
+};
+
+struct bridge_balance_request
+{
+  // Samples at holding, then stepping, in each cycle
+  size_t step_samples;
+  // Step in V of command and the current it injects (A)
+  double amplitude;
+  double step_current;
+  uint64_t steps;
+  size_t onset_samples;
+};
+
+struct bridge_correction_request
+{
+  bool enabled;
+  // Access resistance subtracted from the potential (ohms)
+  double resistance;
+};
+
+struct loopback_request
+{
+  size_t amp;
+  uint64_t levels;
+  // Output range stepped through (V)
+  double low;
+  double high;
+  size_t settle_samples;
+  size_t average_samples;
+};
+
+// Automatic choice of the AI range of one amplifier. The ranges are those
+// of its input channel, widest first.
+struct auto_range_request
+{
+  bool enabled;
+  size_t amp;
+  size_t input_channel;
+  size_t range_count;
+  std::array<size_t, MAX_AUTO_RANGES> ranges;
+  // Full scale of each range (V) and the loop offset stored for it (V at
+  // unity gain), which replaces that of the range being left once scaled
+  // by the AI gain
+  std::array<double, MAX_AUTO_RANGES> full_scales;
+  std::array<double, MAX_AUTO_RANGES> offsets;
+  // Quiet blocks required before a narrower range is picked
+  uint64_t hold_blocks;
+  // Periods the range change output stays up, the one of the change
+  // included
+  size_t flag_samples;
+};
+
+// Filter chain run on the amplifier signal. The component designs the
+// sections for its own period.
+struct filter_request
+{
+  bool enabled;
+  // Notches at line_frequency and its multiples up to harmonics times it
+  double line_frequency;
+  size_t harmonics;
+  double notch_q;
+  // 4th order low-pass, left out when 0 (Hz)
+  double lowpass_cutoff;
+};
+
+// Writes the state last applied to each amplifier in amp_mask to the device
+// again, whatever the shadows believe it holds
+struct reapply_request
+{
+  uint32_t amp_mask;
+};
+
+// A transaction to be committed on a given real-time tick
+struct scheduled_transaction
+{
+  uint64_t tick;
+  mode_transaction transaction;
+};
+
+// One protocol step compiled by the panel. The transaction is committed
+// and held for duration_ticks before the next step.
+struct protocol_step
+{
+  mode_transaction transaction;
+  uint64_t duration_ticks;
+};
+
+// The steps belong to the plugin and are left untouched by the panel until
+// the component reports the protocol finished.
+struct protocol_request
 {
-  LOW = 0,
-  HIGH
+  const protocol_step* steps;
+  size_t count;
 };
 
+struct rt_command
+{
+  command_t type = command_t::CANCEL_ZERO_CALIBRATION;
+  union
+  {
+    zero_calibration_request zero_calibration;
+    mode_transaction transaction;
+    drift_tracking_request drift_tracking;
+    scheduled_transaction scheduled;
+    membrane_test_request membrane_test;
+    bridge_balance_request bridge_balance;
+    bridge_correction_request bridge_correction;
+    protocol_request protocol;
+    reapply_request reapply;
+    loopback_request loopback;
+    auto_range_request auto_range;
+    filter_request filter;
+  };
+};
+
+// Messages sent from the real-time component back to the panel.
+enum class report_t : uint8_t
+{
+  ZERO_OFFSET = 0,
+  TRANSACTION_APPLIED,
+  DRIFT_CORRECTION,
+  SCHEDULE_REJECTED,
+  BRIDGE_BALANCED,
+  PROTOCOL_PROGRESS,
+  LOOPBACK_CALIBRATED,
+  RANGE_CHANGED
+};
+
+struct transaction_result
+{
+  apply_stats stats;
+  bool scheduled;
+  // Tick the transaction was scheduled for and the one it was applied on
+  uint64_t scheduled_tick;
+  uint64_t applied_tick;
+};
+
+struct zero_offset_result
+{
+  double ai_mean;
+  double ao_mean;
+  double ai_standard_error;
+  double ao_standard_error;
+  // 0 when the calibration was aborted
+  uint64_t sample_count;
+};
+
+struct drift_correction
+{
+  // RT::OS::getTime() of the period the new offset was applied in
+  int64_t time;
+  size_t amp;
+  double old_ai_offset;
+  double new_ai_offset;
+};
+
+struct range_change
+{
+  // RT::OS::getTime() of the period the new range was applied in
+  int64_t time;
+  size_t amp;
+  size_t old_range;
+  size_t new_range;
+};
+
+struct protocol_progress
+{
+  // RT::OS::getTime() of the period the step was applied in
+  int64_t time;
+  // Step just applied, or the number of steps applied once finished
+  size_t step;
+  bool finished;
+};
+
+// Channels a loopback calibration ran on and what was measured. The fit is
+// invalid when the calibration could not start or was interrupted.
+struct loopback_report
+{
+  DAQ::Device* device;
+  size_t amp;
+  size_t input_channel;
+  size_t output_channel;
+  size_t ai_range;
+  loopback_result fit;
+};
+
+struct rt_report
+{
+  report_t type = report_t::ZERO_OFFSET;
+  union
+  {
+    zero_offset_result zero_offset;
+    transaction_result transaction;
+    drift_correction drift;
+    bridge_estimate bridge;
+    protocol_progress protocol;
+    loopback_report loopback;
+    range_change range;
+  };
+};
+
+// States the component last applied to the device, as held in its shadows
+struct applied_snapshot
+{
+  DAQ::Device* device;
+  std::array<daq_state, MAX_AMPLIFIERS> states;
+  // Bit i is set when states[i] was applied
+  uint32_t valid_mask;
+};
+
+static_assert(std::is_trivially_copyable_v<rt_command>
+                  && std::is_trivially_copyable_v<rt_report>,
+              "messages are copied byte for byte");
+
 class AMAmpComboBox : public QComboBox
 {
   Q_OBJECT
@@ -45,10 +451,12 @@ public:
   AMAmpComboBox& operator=(const AMAmpComboBox&) = delete;
   AMAmpComboBox& operator=(AMAmpComboBox&&) = delete;
   ~AMAmpComboBox() override = default;
-  void blacken();
+  void setDirty(bool pending);
 
-public slots:
-  void redden();
+private:
+  QPalette clean_palette;
+  QPalette dirty_palette;
+  bool dirty = false;
 };
 
 class AMAmpLineEdit : public QLineEdit
@@ -62,10 +470,12 @@ public:
   AMAmpLineEdit& operator=(const AMAmpLineEdit&) = delete;
   AMAmpLineEdit& operator=(AMAmpLineEdit&&) = delete;
   ~AMAmpLineEdit() override = default;
-  void blacken();
+  void setDirty(bool pending);
 
-public slots:
-  void redden();
+private:
+  QPalette clean_palette;
+  QPalette dirty_palette;
+  bool dirty = false;
 };
 
 class AMAmpSpinBox : public QSpinBox
@@ -79,10 +489,23 @@ public:
   AMAmpSpinBox& operator=(const AMAmpSpinBox&) = delete;
   AMAmpSpinBox& operator=(AMAmpSpinBox&&) = delete;
   ~AMAmpSpinBox() override = default;
-  void blacken();
+  void setDirty(bool pending);
 
-public slots:
-  void redden();
+private:
+  QPalette clean_palette;
+  QPalette dirty_palette;
+  bool dirty = false;
+};
+
+class Plugin;
+
+// Outcome of handing a command to the real-time component
+enum class post_result : uint8_t
+{
+  POSTED = 0,
+  NO_COMPONENT,
+  // The component has not drained the ring, e.g. because it is paused
+  QUEUE_FULL
 };
 
 class Panel : public Widgets::Panel
@@ -90,11 +513,22 @@ class Panel : public Widgets::Panel
   Q_OBJECT
 public:
   Panel(QMainWindow* main_window, Event::Manager* ev_manager);
+  Panel(const Panel&) = delete;
+  Panel(Panel&&) = delete;
+  Panel& operator=(const Panel&) = delete;
+  Panel& operator=(Panel&&) = delete;
+  ~Panel() override;
+
+  void refreshDevices();
 
 public slots:
   void modify() override;
+  void applyAll();
 
 private slots:
+  void selectDevice(int index);
+  void setAmplifierCount(int count);
+  void selectAmplifier(int index);
   void setAIOffset(const QString&);
   void setAOOffset(const QString&);
   void updateOffset(int);
@@ -102,24 +536,70 @@ private slots:
   void updateInputChannel(int);
   void updateOutputChannel(int);
   void setProbeGain(int index);
+  void findZeroOffset();
+  void scheduleSwitch();
+  void clearSchedule();
+  void savePreset();
+  void recallSelectedPreset();
+  void clearPreset();
+  void toggleMembraneTest(bool checked);
+  void balanceBridge();
+  void updateBridgeCorrection();
+  void toggleControlSocket(bool checked);
+  void runProtocol();
+  void stopProtocol();
+  void updateWatchdog();
+  void checkWatchdog();
+  void calibrateLoopback();
+  void forgetCalibration();
+  void updateAutoRange();
+  void updateFilter();
 
 private:
-  enum amp_mode : int8_t
-  {
-    VCLAMP = 0,
-    IEQ0,
-    ICLAMP,
-    VCOMP,
-    VTEST,
-    IRESIST,
-    IFOLLOW,
-    UNKNOWN
-  };
   void customizeGUI();
-  void updateDAQ();
+  void updateDAQ(int64_t requested_at, uint32_t amp_mask);
+  void storeWidgets();
+  void loadWidgets();
+  void scheduleDirtyRefresh();
+  void refreshDirtyState();
+  amp_config& currentAmp() { return amps[current_amp]; }
   void initParameters();
+  const std::vector<DAQ::Device*>& cachedDevices();
+  am_amp2400::Plugin* hostPlugin();
+  post_result postCommand(const rt_command& command);
+  void readReports(RT::OS::Fifo* fifo);
+  void processReport(const rt_report& report);
+  void setZeroCalibrationActive(bool active);
+  void updateDriftTracking();
+  void recallPreset(size_t slot);
+  void refreshPresetNames();
+  void analyseMembraneTests(seqlock<membrane_trace>* traces);
+  void showMembraneFit(const membrane_fit& fit);
+  void stopMembraneWorker();
+  static std::string presetPath();
+  std::string executeControl(const std::string& request);
+  command_limits commandLimits() const;
+  void showProtocolProgress(const protocol_progress& progress);
+  bool appliedState(size_t amp, daq_state& state);
+  void reapplyState(size_t amp);
+  void showLoopbackResult(const loopback_report& report);
+  daq_state resolveState(const amp_config& config) const;
+  static std::string calibrationPath();
+  static std::string controlSocketPath();
+  void logEvent(int64_t time, const QString& message);
+  void updateStatsLabel();
+  void updateLatencyLabel();
   DAQ::Device* current_device = nullptr;
-  RunningStat* zero_signal_ptr = nullptr;
+  std::array<daq_shadow, MAX_AMPLIFIERS> applied_daq;
+  apply_stats daq_stats {};
+
+  // Reports from the real-time component are drained on this thread and
+  // forwarded to the GUI thread as queued calls.
+  std::thread report_thread;
+  std::atomic<bool> report_thread_running = false;
+  // Fits the averaged membrane test traces while the test runs
+  std::thread membrane_worker;
+  std::atomic<bool> membrane_worker_running = false;
 
   QRadioButton* iclampButton = nullptr;
   QRadioButton* vclampButton = nullptr;
@@ -129,6 +609,9 @@ private:
   QRadioButton* iresistButton = nullptr;
   QRadioButton* ifollowButton = nullptr;
   QButtonGroup* ampButtonGroup = nullptr;
+  QComboBox* devicesComboBox = nullptr;
+  QSpinBox* ampCountBox = nullptr;
+  QComboBox* ampSelectComboBox = nullptr;
   AMAmpSpinBox* inputBox = nullptr;
   AMAmpSpinBox* outputBox = nullptr;
   AMAmpSpinBox* bit1Box = nullptr;
@@ -139,31 +622,182 @@ private:
   AMAmpComboBox* probeGainComboBox = nullptr;
   QLabel* aiOffsetUnits = nullptr;
   QLabel* aoOffsetUnits = nullptr;
+  QPushButton* findZeroButton = nullptr;
+  QLineEdit* zeroToleranceEdit = nullptr;
+  QGroupBox* driftGroupBox = nullptr;
+  QLineEdit* driftTimeConstantEdit = nullptr;
+  QLineEdit* driftThresholdEdit = nullptr;
+  QPlainTextEdit* eventLog = nullptr;
+  QLineEdit* scheduleDelayEdit = nullptr;
+  QComboBox* presetComboBox = nullptr;
+  QPushButton* membraneTestButton = nullptr;
+  QLineEdit* membraneAmplitudeEdit = nullptr;
+  QLineEdit* membranePulseEdit = nullptr;
+  QLabel* membraneResultLabel = nullptr;
+  QPushButton* bridgeBalanceButton = nullptr;
+  QLineEdit* bridgeStepEdit = nullptr;
+  QLineEdit* bridgeWidthEdit = nullptr;
+  QSpinBox* bridgeStepCountBox = nullptr;
+  QCheckBox* bridgeCorrectionBox = nullptr;
+  QLineEdit* bridgeResistanceEdit = nullptr;
+  QCheckBox* controlSocketBox = nullptr;
+  QPushButton* protocolRunButton = nullptr;
+  QPushButton* protocolStopButton = nullptr;
+  QLabel* protocolStatusLabel = nullptr;
+  QGroupBox* watchdogGroupBox = nullptr;
+  QLineEdit* watchdogIntervalEdit = nullptr;
+  QCheckBox* watchdogRepairBox = nullptr;
+  QTimer* watchdogTimer = nullptr;
+  QLineEdit* loopbackLowEdit = nullptr;
+  QLineEdit* loopbackHighEdit = nullptr;
+  QSpinBox* loopbackLevelsBox = nullptr;
+  QLineEdit* loopbackSettleEdit = nullptr;
+  QLineEdit* loopbackAverageEdit = nullptr;
+  QPushButton* loopbackButton = nullptr;
+  QLabel* loopbackResultLabel = nullptr;
+  QCheckBox* calibrationBox = nullptr;
+  QGroupBox* autoRangeGroupBox = nullptr;
+  QLineEdit* autoRangeHoldEdit = nullptr;
+  QLineEdit* autoRangeFlagEdit = nullptr;
+  QGroupBox* filterGroupBox = nullptr;
+  QComboBox* filterLineComboBox = nullptr;
+  QSpinBox* filterHarmonicsBox = nullptr;
+  QLineEdit* filterNotchQEdit = nullptr;
+  QLineEdit* filterLowpassEdit = nullptr;
+  QLabel* daqStatsLabel = nullptr;
+  QLabel* latencyLabel = nullptr;
+  // Used when there is no real-time component to record into
+  apply_latency local_latency;
+
+  // Important parameters. Amplifier gains live in amp_profile. The widgets
+  // always show the amplifier at current_amp.
+  std::array<amp_config, MAX_AMPLIFIERS> amps;
+  // Configuration last handed to the DAQ for each amplifier. Widgets whose
+  // value differs from it are shown as pending.
+  std::array<amp_config, MAX_AMPLIFIERS> applied_amps;
+  bool dirty_refresh_pending = false;
+  QFont mode_font;
+  QFont applied_mode_font;
+  size_t amp_count = 1;
+  size_t current_amp = 0;
+  size_t zero_calibration_amp = 0;
+  // Set from the calibration request until the component reports back
+  bool zero_calibration_running = false;
+  // Loaded once with the panel; recalling a preset never touches the disk
+  preset_bank presets;
+  // Loopback offsets per device, channel pair and range, kept like presets
+  calibration_cache calibrations;
+  // Requests from other processes, executed on the GUI thread
+  control_server control;
+  // Protocol handed to the component, kept to follow its progress
+  std::vector<protocol_entry> protocol_entries;
+  bool protocol_running = false;
+  // The watchdog reads back one amplifier per timeout. A mismatch counts
+  // once it is seen on two visits in a row, as the component may be
+  // applying a state while the device is read.
+  size_t watchdog_amp = 0;
+  std::array<uint32_t, MAX_AMPLIFIERS> watchdog_mismatches {};
+  uint32_t watchdog_warned = 0;
+};
 
-  // Important parameters
-  static constexpr double iclamp_ai_gain = 1.0;  // (1 V / V)
-  static constexpr double iclamp_ao_gain = 1.0;  // (2 nA / V) ...hmm
-  static constexpr double izero_ai_gain = 200e-3;  // (1 V / V)
-  static constexpr double izero_ao_gain = 1;  // No output
-  static constexpr double vclamp_ai_gain = 2e-9;  // 1 mV / pA
-  static constexpr double vclamp_ao_gain = 50;  // 50 mV / V
-  int input_channel = 0;
-  int output_channel = 0;
-  amp_mode mode = IEQ0;
-  int digital_line_0 = 0;
-  int digital_line_1 = 0;
-  int digital_line_2 = 0;
-  double probe_gain_factor;
-  double ai_offset = 0;
-  double ao_offset = 0;
-  int signal_count = 0;
-  double zero_offset = 0;
+class Component : public Widgets::Component
+{
+public:
+  explicit Component(Widgets::Plugin* plugin);
+  void execute() override;
+
+private:
+  void processCommands();
+  void accumulateZeroOffset();
+  void abortZeroCalibration();
+  void trackDrift();
+  void applyTransaction(const mode_transaction& transaction,
+                        state_source source,
+                        uint64_t scheduled_tick);
+  void applyDueTransactions();
+  void runMembraneTest();
+  void runBridgeBalance();
+  void publishState(size_t amp);
+  void runProtocol();
+  void finishProtocol();
+  void reapplyStates(uint32_t amp_mask);
+  void startLoopback(const loopback_request& request);
+  void runLoopback();
+  void reportLoopback(const loopback_result& fit);
+  void runAutoRange();
+  void configureFilter();
+  void publishAppliedStates();
+  am_amp2400::Plugin* host_plugin = nullptr;
+  RT::OS::Fifo* fifo = nullptr;
+  apply_latency* latency = nullptr;
+  DAQ::Device* shadow_device = nullptr;
+  std::array<daq_shadow, MAX_AMPLIFIERS> applied_daq;
+  mean_estimator<> ai_zero_signal;
+  mean_estimator<> ao_zero_signal;
+  bool zero_calibration_active = false;
+  drift_tracker ai_drift;
+  drift_tracking_request drift_config {};
+  // Periods executed since the component was created
+  uint64_t tick = 0;
+  tick_queue<mode_transaction, MAX_SCHEDULED_TRANSACTIONS> schedule;
+  membrane_test membrane;
+  bridge_balance bridge;
+  bridge_correction_request bridge_correction {};
+  // Command (V) of the current injected during the previous period
+  double previous_injected = 0.0;
+  loopback_calibration loopback;
+  // Amplifier being calibrated and the state restored afterwards
+  size_t loopback_amp = 0;
+  DAQ::Device* loopback_device = nullptr;
+  daq_state loopback_saved {};
+  auto_range_request auto_range_config {};
+  auto_ranger<> ai_ranger;
+  // Periods left before the range change output drops back to 0
+  size_t range_flag_remaining = 0;
+  filter_request filter_config {};
+  biquad_chain line_filter;
+  // Protocol being run, its next step and the tick that step is due on
+  protocol_request protocol {};
+  size_t protocol_next = 0;
+  uint64_t protocol_step_end = 0;
 };
 
 class Plugin : public Widgets::Plugin
 {
 public:
   explicit Plugin(Event::Manager* ev_manager);
+  void receiveEvent(Event::Object* event) override;
+  RT::OS::Fifo* getFifo() { return fifo.get(); }
+  spsc_ring<rt_command, COMMAND_RING_CAPACITY>& getCommands()
+  {
+    return commands;
+  }
+  seqlock<membrane_trace>& getMembraneTraces() { return membrane_traces; }
+  seqlock<applied_snapshot>& getAppliedStates() { return applied_states; }
+  state_log& getStateLog() { return state_history; }
+  std::vector<protocol_step>& getProtocolSteps() { return protocol_steps; }
+  apply_latency& getLatency() { return latency; }
+  uint64_t getTick() const { return tick.load(std::memory_order_relaxed); }
+  void setTick(uint64_t value) { tick.store(value, std::memory_order_relaxed); }
+
+private:
+  // Reports from the component (writeRT) to the panel (read)
+  std::unique_ptr<RT::OS::Fifo> fifo;
+  // Commands from the panel to the component. Every state the component
+  // applies travels inside a command, so it never reads the panel's
+  // configuration.
+  spsc_ring<rt_command, COMMAND_RING_CAPACITY> commands;
+  // Averaged membrane test responses from the component
+  seqlock<membrane_trace> membrane_traces;
+  // What the component last applied, checked by the panel's watchdog
+  seqlock<applied_snapshot> applied_states;
+  // Every state applied to the DAQ, appended by the component and panel
+  state_log state_history;
+  // Steps of the protocol last handed to the component
+  std::vector<protocol_step> protocol_steps;
+  // Written by the component, read by the panel
+  apply_latency latency;
+  std::atomic<uint64_t> tick = 0;
 };
 
 }  // namespace am_amp2400